@@ -0,0 +1,82 @@
+#pragma once
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <utility>
+
+#ifdef _MSC_VER
+#include <malloc.h>
+#endif
+
+// Heap array of trivially copyable elements, aligned to a cache line (or more)
+// so kernels can stream through it with aligned vector loads
+template<typename T>
+class AlignedBuffer
+{
+public:
+	AlignedBuffer() {}
+
+	explicit AlignedBuffer(size_t count, size_t alignment = 64)
+	{
+		Allocate(count, alignment);
+	}
+
+	~AlignedBuffer()
+	{
+		Free();
+	}
+
+	AlignedBuffer(const AlignedBuffer&) = delete;
+	AlignedBuffer& operator=(const AlignedBuffer&) = delete;
+
+	AlignedBuffer(AlignedBuffer&& other)
+		: data(other.data), count(other.count)
+	{
+		other.data = nullptr;
+		other.count = 0;
+	}
+
+	AlignedBuffer& operator=(AlignedBuffer&& other)
+	{
+		std::swap(data, other.data);
+		std::swap(count, other.count);
+		return *this;
+	}
+
+	void Allocate(size_t newCount, size_t alignment = 64)
+	{
+		Free();
+		size_t bytes = (newCount * sizeof(T) + alignment - 1) / alignment * alignment;
+#ifdef _MSC_VER
+		data = (T*)_aligned_malloc(bytes, alignment);
+#else
+		void* p = nullptr;
+		data = posix_memalign(&p, alignment, bytes) == 0 ? (T*)p : nullptr;
+#endif
+		if(!data && bytes)
+			throw std::bad_alloc();
+		count = newCount;
+	}
+
+	T* Data() { return data; }
+	const T* Data() const { return data; }
+	size_t Size() const { return count; }
+
+	T& operator[](size_t i) { return data[i]; }
+	const T& operator[](size_t i) const { return data[i]; }
+
+private:
+	void Free()
+	{
+#ifdef _MSC_VER
+		_aligned_free(data);
+#else
+		free(data);
+#endif
+		data = nullptr;
+		count = 0;
+	}
+
+	T* data = nullptr;
+	size_t count = 0;
+};
@@ -0,0 +1,95 @@
+#include "BitGrid.hpp"
+#include <algorithm>
+
+void BitGrid::Resize(int newRows, int newColumns)
+{
+	rows = newRows;
+	columns = newColumns;
+	rowWords = columns / 64 + 1;
+	stride = rowWords + 2;
+	words.Allocate((size_t)(rows + 2) * stride);
+	std::fill(words.Data(), words.Data() + words.Size(), 0);
+}
+
+void BitGrid::FillHalo(Boundary boundary)
+{
+	FillHalo(boundary, 0, rows);
+}
+
+void BitGrid::FillHalo(Boundary boundary, int firstRow, int endRow)
+{
+	for(int r = std::max(firstRow - 1, 0); r < std::min(endRow + 1, rows); r++)
+		FillSides(boundary, r);
+	if(firstRow <= 0)
+		FillHaloRow(boundary, -1);
+	if(endRow >= rows)
+		FillHaloRow(boundary, rows);
+}
+
+void BitGrid::FillSides(Boundary boundary, int row)
+{
+	const int last = columns - 1;
+	bool left = boundary != Boundary::DEAD && Get(row, boundary == Boundary::TORUS ? last : 0);
+	bool right = boundary != Boundary::DEAD && Get(row, boundary == Boundary::TORUS ? 0 : last);
+
+	uint64_t* cells = Row(row);
+	cells[-1] = (uint64_t)left << 63;
+	uint64_t& word = cells[columns / 64];
+	uint64_t bit = 1ull << (columns % 64);
+	word = right ? word | bit : word & ~bit;
+}
+
+void BitGrid::FillHaloRow(Boundary boundary, int row)
+{
+	uint64_t* halo = Row(row) - 1;
+	if(boundary == Boundary::DEAD)
+	{
+		std::fill(halo, halo + stride, 0);
+		return;
+	}
+
+	// A whole row with its sides, which may not be among the rows filled
+	int source = (row < 0) == (boundary == Boundary::TORUS) ? rows - 1 : 0;
+	FillSides(boundary, source);
+	std::copy(Row(source) - 1, Row(source) - 1 + stride, halo);
+}
+
+void BitGrid::ClearPadding()
+{
+	const uint64_t keep = (1ull << (columns % 64)) - 1;
+	for(int r = 0; r < rows; r++)
+		Row(r)[columns / 64] &= keep;
+}
+
+void StepLife(BitGrid& grid, BitGrid& next, LifeRowKernel kernel, WorkerPool* workers, Boundary boundary)
+{
+	grid.FillHalo(boundary);
+
+	const int rows = grid.Rows();
+	auto stepRows = [&](int task, int numTasks)
+	{
+		int first = (int)((int64_t)rows * task / numTasks);
+		int end = (int)((int64_t)rows * (task + 1) / numTasks);
+		for(int r = first; r < end; r++)
+			kernel(grid.Row(r - 1), grid.Row(r), grid.Row(r + 1), next.Row(r), grid.RowWords());
+	};
+
+	if(workers)
+	{
+		int numTasks = std::min(rows, workers->NumThreads() * 4);
+		workers->Run(numTasks, [&](int task) { stepRows(task, numTasks); }, "life rows");
+	}
+	else
+		stepRows(0, 1);
+
+	next.ClearPadding();
+}
+
+void BitGrid::Swap(BitGrid& other)
+{
+	std::swap(rows, other.rows);
+	std::swap(columns, other.columns);
+	std::swap(rowWords, other.rowWords);
+	std::swap(stride, other.stride);
+	std::swap(words, other.words);
+}
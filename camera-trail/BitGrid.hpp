@@ -0,0 +1,80 @@
+#pragma once
+#include "AlignedBuffer.hpp"
+#include "CellularAutomata.hpp"
+#include "LifeKernels.hpp"
+#include "WorkerPool.hpp"
+#include <cstdint>
+
+inline int CountBits(uint64_t x)
+{
+#if defined(__GNUC__)
+	return __builtin_popcountll(x);
+#else
+	x = x - ((x >> 1) & 0x5555555555555555ull);
+	x = (x & 0x3333333333333333ull) + ((x >> 2) & 0x3333333333333333ull);
+	x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0full;
+	return (int)((x * 0x0101010101010101ull) >> 56);
+#endif
+}
+
+// Of a non-zero word
+inline int LowestBit(uint64_t x)
+{
+	return CountBits((x & (0 - x)) - 1);
+}
+
+// The automaton grid, 64 cells to a word, bit j of a row's word w being
+// column 64 * w + j. Every row has a halo around it: a word on the left whose
+// top bit is column -1, the bit right after the last column, and a spare word
+// on the right, so a row kernel can read the neighbours of every cell without
+// looking at where the row ends. There is a halo row above and below too.
+// FillHalo() fills all of them in from the cells before a step.
+class BitGrid
+{
+public:
+	void Resize(int rows, int columns);
+
+	int Rows() const { return rows; }
+	int Columns() const { return columns; }
+
+	// Words of cells in a row, the halo bit included
+	int RowWords() const { return rowWords; }
+
+	// First word of cells of a row, -1 and Rows() are the halo rows
+	uint64_t* Row(int row) { return words.Data() + (size_t)(row + 1) * stride + 1; }
+	const uint64_t* Row(int row) const { return words.Data() + (size_t)(row + 1) * stride + 1; }
+
+	bool Get(int row, int column) const { return (Row(row)[column / 64] >> (column % 64)) & 1; }
+	void Set(int row, int column) { Row(row)[column / 64] |= 1ull << (column % 64); }
+
+	// Everything, halo and all, for clearing in pieces
+	uint64_t* Words() { return words.Data(); }
+	size_t NumWords() const { return words.Size(); }
+
+	// Column -1 and Columns() of every row, then rows -1 and Rows() whole,
+	// corners and all, from the cells past the edges by the boundary
+	void FillHalo(Boundary boundary);
+
+	// Only what stepping rows firstRow up to endRow reads, the rows either side included
+	void FillHalo(Boundary boundary, int firstRow, int endRow);
+
+	// Clears whatever a step wrote past the last column
+	void ClearPadding();
+
+	void Swap(BitGrid& other);
+
+private:
+	void FillSides(Boundary boundary, int row);
+	void FillHaloRow(Boundary boundary, int row);
+
+	int rows = 0;
+	int columns = 0;
+	int rowWords = 0;
+	int stride = 0;	// rowWords plus a halo word on either side
+	AlignedBuffer<uint64_t> words;
+};
+
+// One generation of Game of Life from grid into next, the same size. Every
+// row only reads grid, so blocks of rows are stepped at once on the pool if
+// there is one.
+void StepLife(BitGrid& grid, BitGrid& next, LifeRowKernel kernel, WorkerPool* workers, Boundary boundary);
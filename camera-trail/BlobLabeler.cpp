@@ -0,0 +1,163 @@
+#include "BlobLabeler.hpp"
+#include <algorithm>
+
+void BlobLabeler::Begin(int numBands)
+{
+	bands.resize(numBands);
+	for(Band& band : bands)
+	{
+		band.runs.clear();
+		band.parents.clear();
+		band.previousRow = 0;
+		band.currentRow = 0;
+	}
+}
+
+void BlobLabeler::AddRow(int bandIndex, int row, const int* litColumns, int numLit)
+{
+	if(numLit == 0)
+		return;
+
+	Band& band = bands[bandIndex];
+	band.currentRow = band.runs.size();
+
+	// Consecutive columns make a run
+	int begin = litColumns[0];
+	for(int k = 1; k <= numLit; k++)
+	{
+		if(k == numLit || litColumns[k] != litColumns[k - 1] + 1)
+		{
+			band.parents.push_back((int)band.runs.size());
+			band.runs.push_back({ row, begin, litColumns[k - 1] + 1 });
+			if(k < numLit)
+				begin = litColumns[k];
+		}
+	}
+
+	// Only the row right above can touch this one
+	size_t numPrevious = band.currentRow - band.previousRow;
+	if(numPrevious > 0 && band.runs[band.previousRow].row == row - 1)
+	{
+		JoinRows(band.parents, &band.runs[band.previousRow], numPrevious, (int)band.previousRow,
+			&band.runs[band.currentRow], band.runs.size() - band.currentRow, (int)band.currentRow);
+	}
+	band.previousRow = band.currentRow;
+}
+
+void BlobLabeler::Finish(int minArea)
+{
+	// One forest for all bands
+	parents.clear();
+	std::vector<int> offsets(bands.size());
+	for(size_t b = 0; b < bands.size(); b++)
+	{
+		int offset = (int)parents.size();
+		offsets[b] = offset;
+		for(int parent : bands[b].parents)
+			parents.push_back(parent + offset);
+	}
+
+	// Seams: the last row of a band against the first row of the next one
+	for(size_t b = 0; b + 1 < bands.size(); b++)
+	{
+		const Band& upper = bands[b];
+		const Band& lower = bands[b + 1];
+		if(upper.runs.empty() || lower.runs.empty())
+			continue;
+
+		const Run* above = &upper.runs[upper.previousRow];
+		size_t numAbove = upper.runs.size() - upper.previousRow;
+
+		const Run* below = lower.runs.data();
+		size_t numBelow = 0;
+		while(numBelow < lower.runs.size() && lower.runs[numBelow].row == below->row)
+			numBelow++;
+
+		if(below->row == above->row + 1)
+			JoinRows(parents, above, numAbove, offsets[b] + (int)upper.previousRow, below, numBelow, offsets[b + 1]);
+	}
+
+	// Measure every component, numbering them in the order their first run shows up
+	blobs.clear();
+	moments.clear();
+	blobOfRun.assign(parents.size(), -1);
+	for(size_t b = 0; b < bands.size(); b++)
+	{
+		for(size_t r = 0; r < bands[b].runs.size(); r++)
+		{
+			const Run& run = bands[b].runs[r];
+			int root = Find(parents, offsets[b] + (int)r);
+			if(blobOfRun[root] < 0)
+			{
+				blobOfRun[root] = (int)blobs.size();
+				blobs.push_back({ 0.0f, 0.0f, 0, run.begin, run.row, run.end - 1, run.row });
+				moments.push_back({ 0, 0 });
+			}
+
+			Blob& blob = blobs[blobOfRun[root]];
+			Moments& m = moments[blobOfRun[root]];
+			int length = run.end - run.begin;
+			blob.area += length;
+			blob.left = std::min(blob.left, run.begin);
+			blob.right = std::max(blob.right, run.end - 1);
+			blob.bottom = std::max(blob.bottom, run.row);
+			m.x += (int64_t)(run.begin + run.end - 1) * length;	// Twice the sum of the columns
+			m.y += (int64_t)run.row * length;
+		}
+	}
+
+	size_t kept = 0;
+	for(size_t i = 0; i < blobs.size(); i++)
+	{
+		Blob blob = blobs[i];
+		if(blob.area < minArea)
+			continue;
+
+		blob.x = (float)((double)moments[i].x / (2.0 * blob.area));
+		blob.y = (float)((double)moments[i].y / blob.area);
+		blobs[kept++] = blob;
+	}
+	blobs.resize(kept);
+}
+
+int BlobLabeler::Find(std::vector<int>& parents, int i)
+{
+	// Path halving
+	while(parents[i] != i)
+	{
+		parents[i] = parents[parents[i]];
+		i = parents[i];
+	}
+	return i;
+}
+
+void BlobLabeler::Union(std::vector<int>& parents, int a, int b)
+{
+	a = Find(parents, a);
+	b = Find(parents, b);
+
+	// The older run stays the root, which keeps the trees shallow for rows added later
+	if(a < b)
+		parents[b] = a;
+	else if(b < a)
+		parents[a] = b;
+}
+
+void BlobLabeler::JoinRows(std::vector<int>& parents, const Run* above, size_t numAbove, int aboveOffset,
+	const Run* below, size_t numBelow, int belowOffset)
+{
+	// Both rows are sorted, so walk them side by side. Diagonal neighbours
+	// count, so runs touch when they overlap after growing by one column.
+	size_t i = 0;
+	size_t j = 0;
+	while(i < numAbove && j < numBelow)
+	{
+		if(above[i].begin <= below[j].end && below[j].begin <= above[i].end)
+			Union(parents, aboveOffset + (int)i, belowOffset + (int)j);
+
+		if(above[i].end < below[j].end)
+			i++;
+		else
+			j++;
+	}
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// A connected bright region of one frame
+struct Blob
+{
+	float x;	// Centroid
+	float y;
+	int area;	// Pixels
+	int left;	// Bounding box, inclusive
+	int top;
+	int right;
+	int bottom;
+};
+
+// Finds 8-connected regions in the threshold mask, one row of lit columns at a
+// time. The mask is never stored: every row becomes a handful of runs, and runs
+// that touch a run of the row above are joined with union-find. Bands of rows
+// are labeled independently, so each band can be fed on its own thread, and
+// Finish() joins the runs along the seams between bands.
+class BlobLabeler
+{
+public:
+	// Bands are numbered top to bottom and must not overlap
+	void Begin(int numBands);
+
+	// litColumns are the lit pixels of row, in increasing order. Rows of a band
+	// have to be added top to bottom. Only touches the band's own data.
+	void AddRow(int band, int row, const int* litColumns, int numLit);
+
+	// Joins the bands and measures every blob, leaving out those smaller than minArea
+	void Finish(int minArea = 1);
+
+	// Ordered by the topmost row they reach
+	const std::vector<Blob>& Blobs() const { return blobs; }
+
+private:
+	struct Run
+	{
+		int row;
+		int begin;
+		int end;	// Exclusive
+	};
+
+	struct Band
+	{
+		std::vector<Run> runs;
+		std::vector<int> parents;	// Union-find forest over runs, band local
+		size_t previousRow = 0;	// First run of the last row that had any
+		size_t currentRow = 0;	// First run of the row being added
+	};
+
+	static int Find(std::vector<int>& parents, int i);
+	static void Union(std::vector<int>& parents, int a, int b);
+
+	// Joins every run of one row with the runs of the row below that it touches.
+	// The offsets are where each row's first run is in parents.
+	static void JoinRows(std::vector<int>& parents, const Run* above, size_t numAbove, int aboveOffset,
+		const Run* below, size_t numBelow, int belowOffset);
+
+	// Sums for the centroids, which floats would lose precision on
+	struct Moments
+	{
+		int64_t x;
+		int64_t y;
+	};
+
+	std::vector<Band> bands;
+	std::vector<int> parents;	// Every band's runs, one after another
+	std::vector<int> blobOfRun;
+	std::vector<Blob> blobs;
+	std::vector<Moments> moments;
+};
@@ -0,0 +1,80 @@
+#include "BlobTracker.hpp"
+#include <algorithm>
+#include <cmath>
+
+static const float PI = 3.14159265f;
+
+void BlobTracker::Update(const std::vector<Blob>& blobs)
+{
+	segments.clear();
+
+	// Every track and blob close enough, measured from where the track was heading
+	pairs.clear();
+	for(int t = 0; t < (int)tracks.size(); t++)
+	{
+		const Track& track = tracks[t];
+		float px = track.x + track.vx * (track.missed + 1);
+		float py = track.y + track.vy * (track.missed + 1);
+		for(int b = 0; b < (int)blobs.size(); b++)
+		{
+			if(blobs[b].area < MIN_AREA)
+				continue;
+
+			float distance = std::hypot(blobs[b].x - px, blobs[b].y - py);
+			if(distance <= MAX_JUMP)
+				pairs.push_back({ distance, t, b });
+		}
+	}
+
+	// Nearest first, every track and blob used once
+	std::sort(pairs.begin(), pairs.end(), [](const Pair& a, const Pair& b) { return a.distance < b.distance; });
+	trackOfBlob.assign(blobs.size(), -1);
+	size_t numTracks = tracks.size();
+	matched.assign(numTracks, false);
+	for(const Pair& pair : pairs)
+	{
+		if(matched[pair.track] || trackOfBlob[pair.blob] >= 0)
+			continue;
+
+		matched[pair.track] = true;
+		trackOfBlob[pair.blob] = pair.track;
+
+		Track& track = tracks[pair.track];
+		const Blob& blob = blobs[pair.blob];
+		float radius = std::sqrt(blob.area / PI);
+		segments.push_back({ track.x, track.y, blob.x, blob.y, (track.radius + radius) / 2 });
+
+		track.vx = (blob.x - track.x) / (track.missed + 1);
+		track.vy = (blob.y - track.y) / (track.missed + 1);
+		track.x = blob.x;
+		track.y = blob.y;
+		track.radius = radius;
+		track.missed = 0;
+	}
+
+	// Blobs nobody was following start tracks of their own
+	for(int b = 0; b < (int)blobs.size(); b++)
+	{
+		const Blob& blob = blobs[b];
+		if(trackOfBlob[b] >= 0 || blob.area < MIN_AREA)
+			continue;
+
+		float radius = std::sqrt(blob.area / PI);
+		tracks.push_back({ nextId++, blob.x, blob.y, 0.0f, 0.0f, radius, 0 });
+		segments.push_back({ blob.x, blob.y, blob.x, blob.y, radius });
+	}
+
+	// Tracks that were not seen for too long are gone
+	for(size_t t = 0; t < numTracks; t++)
+	{
+		if(!matched[t])
+			tracks[t].missed++;
+	}
+	tracks.erase(std::remove_if(tracks.begin(), tracks.end(), [](const Track& track) { return track.missed > MAX_MISSED; }), tracks.end());
+}
+
+void BlobTracker::Reset()
+{
+	tracks.clear();
+	segments.clear();
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include "BlobLabeler.hpp"
+#include <vector>
+
+// A light followed from frame to frame
+struct Track
+{
+	int id;
+	float x;	// Centroid when last seen
+	float y;
+	float vx;	// Pixels per frame
+	float vy;
+	float radius;	// Of a disc with the blob's area
+	int missed;	// Frames in a row it was not seen
+};
+
+// The stroke a track moved along since the previous frame. A track that was
+// just found starts with a dot, where both ends are the same.
+struct StrokeSegment
+{
+	float x0;
+	float y0;
+	float x1;
+	float y1;
+	float radius;
+};
+
+// Pairs the blobs of every frame with the tracks of the one before, nearest
+// first, so that a moving light can be drawn as a line instead of a dot per frame.
+class BlobTracker
+{
+public:
+	// Blobs smaller than this are noise, not a light
+	static const int MIN_AREA = 4;
+
+	// Furthest a light can move in one frame and still be the same light
+	static constexpr float MAX_JUMP = 160.0f;
+
+	// Frames a track is kept without a blob, so a flicker does not break the stroke
+	static const int MAX_MISSED = 2;
+
+	void Update(const std::vector<Blob>& blobs);
+
+	// Drops every track, the next Update starts over
+	void Reset();
+
+	const std::vector<Track>& Tracks() const { return tracks; }
+
+	// What the tracks moved along in the last Update
+	const std::vector<StrokeSegment>& Segments() const { return segments; }
+
+private:
+	struct Pair
+	{
+		float distance;
+		int track;
+		int blob;
+	};
+
+	std::vector<Track> tracks;
+	std::vector<StrokeSegment> segments;
+	std::vector<Pair> pairs;
+	std::vector<int> trackOfBlob;
+	std::vector<bool> matched;	// By track
+	int nextId = 0;
+};
@@ -0,0 +1,796 @@
+#include "Canvas.hpp"
+#include <algorithm>
+#include <cmath>
+
+static const uint8_t PUNCHED_ALPHA = 255 - 200;
+static const size_t CLEAN_WORDS_PER_FRAME = 1024;	// 64K cells
+static const float ROI_MARGIN = 16.0f;	// Pixels around a light's predicted extent
+static const uint32_t OPAQUE_FADE_TABLE[] = { 0xff000000 };	// The camera layer has nothing to fade
+
+// Set bits of a packed row of bits, from begin up to end
+static int CountBits(const uint64_t* words, int begin, int end)
+{
+	int first = begin / 64;
+	int last = (end - 1) / 64;
+	uint64_t head = ~0ull << (begin % 64);
+	uint64_t tail = ~0ull >> (63 - (end - 1) % 64);
+	if(first == last)
+		return CountBits(words[first] & head & tail);
+
+	int count = CountBits(words[first] & head) + CountBits(words[last] & tail);
+	for(int w = first + 1; w < last; w++)
+		count += CountBits(words[w]);
+	return count;
+}
+
+// Keeps the even pixels of a row, for the DECIMATED camera
+static void DecimateRow(const uint32_t* src, uint8_t* dst, int width)
+{
+	for(int j = 0; j < width; j++, dst += 4)
+	{
+		uint32_t p = src[j * 2];
+		dst[0] = (uint8_t)(p >> 16);
+		dst[1] = (uint8_t)(p >> 8);
+		dst[2] = (uint8_t)p;
+		dst[3] = 255;
+	}
+}
+
+static std::vector<uint8_t> BuildFadeTable(FadeCurve curve)
+{
+	std::vector<uint8_t> alphaByAge;
+	for(int age = 0; alphaByAge.empty() || alphaByAge.back() != 255; age++)
+	{
+		double alpha = 255.0;
+		if(curve == FadeCurve::LINEAR)
+			alpha = std::min(PUNCHED_ALPHA + 3.0 * age, 255.0);
+		else if(curve == FadeCurve::EXPONENTIAL)
+			alpha = 255.0 - (255 - PUNCHED_ALPHA) * std::exp(-age / 16.0);
+		alphaByAge.push_back((uint8_t)std::lround(alpha));
+	}
+	return alphaByAge;
+}
+
+Canvas::Canvas(int width, int height, int cellSize)
+	: width(width), height(height), cellSize(cellSize), gridVertices(sf::Quads)
+{
+	// Opaque black, like a fresh sf::Image
+	camPixels.Allocate((size_t)width * height * 4);
+	for(size_t i = 0; i < camPixels.Size(); i += 4)
+	{
+		camPixels[i + 0] = 0;
+		camPixels[i + 1] = 0;
+		camPixels[i + 2] = 0;
+		camPixels[i + 3] = 255;
+	}
+
+	// Round up, so pixels on the right edge still land in a cell
+	columns = (width + cellSize - 1) / cellSize;
+	rows = height / cellSize + 1;
+	grid.Resize(rows, columns);
+	nextGrid.Resize(rows, columns);
+	spareGrid.Resize(rows, columns);
+	spareClean = spareGrid.NumWords();
+	sparseLife.Resize(rows, columns);
+
+	cell.setSize(sf::Vector2f((float)cellSize, (float)cellSize));
+	cell.setFillColor(sf::Color(255, 255, 255, 10));
+
+	// Bands of whole cell rows, about BAND_BYTES of camera and image data each
+	// so a band stays in the worker's L2
+	const int BAND_BYTES = 256 * 1024;
+	int bandCells = std::max(BAND_BYTES / (width * 8 * cellSize), 1);
+	for(int first = 0; first < height; first += bandCells * cellSize)
+	{
+		Band band;
+		band.firstRow = first;
+		band.endRow = std::min(first + bandCells * cellSize, height);
+		bands.push_back(std::move(band));
+	}
+
+	litColumns.resize(bands.size() * width);
+	maskWords = (width + 63) / 64;
+	for(Band& band : bands)
+	{
+		band.tileMax.resize((width + BRIGHT_TILE_SIZE - 1) / BRIGHT_TILE_SIZE);
+		band.litMask.resize((size_t)cellSize * maskWords);
+		band.anyMask.assign(maskWords, 0);
+	}
+	SetKernelIsa(BestKernelIsa());
+	SetLifeIsa(BestLifeIsa());
+
+	tileColumns = (width + TILE_SIZE - 1) / TILE_SIZE;
+	for(int y = 0; y < height; y += TILE_SIZE)
+	for(int x = 0; x < width; x += TILE_SIZE)
+	{
+		Tile tile;
+		tile.x = x;
+		tile.y = y;
+		tile.width = std::min(TILE_SIZE, width - x);
+		tile.height = std::min(TILE_SIZE, height - y);
+		tile.newest = 0;
+		tile.dirty = false;
+		tile.stroked = false;
+		tile.pixels.Allocate((size_t)tile.width * tile.height * 4);
+		tiles.push_back(std::move(tile));
+	}
+	tileLit = std::vector<std::atomic<uint8_t>>(tiles.size());
+	for(std::atomic<uint8_t>& lit : tileLit)
+		lit.store(0, std::memory_order_relaxed);
+
+	// Nothing was ever lit
+	litStamps.Allocate((size_t)width * height);
+	SetFadeCurve(FadeCurve::LINEAR);
+	ClampStamps(0);
+}
+
+void Canvas::ProcessFrame(const uint32_t* pixels, double time, DrawMode mode, bool trail)
+{
+	// Anything longer than the whole fade is as good as the whole fade
+	int64_t tick = std::llround(time * FADE_TICKS_PER_SECOND);
+	int64_t elapsed = lastTick < 0 ? 0 : std::min(std::max(tick - lastTick, (int64_t)0), (int64_t)maxAge + 1);
+	lastTick = tick;
+	if(!trail)
+		elapsed = 0;
+
+	AdvanceFadeClock((uint32_t)elapsed);
+	CleanSpareGrid(CLEAN_WORDS_PER_FRAME);
+
+	PixelKernelOptions options;
+	options.threshold = TRESHOLD;
+	options.draw = mode != DrawMode::NONE;
+	options.punch = mode != DrawMode::SAND && mode != DrawMode::STROKE;	// Looks better without the trail
+	options.now = (uint16_t)fadeClock;
+	options.elapsed = (uint16_t)elapsed;
+	if(mode == DrawMode::STROKE)
+		options.elapsed = 0;	// Lit pixels are left alone, the strokes draw
+	options.fadeTable = fadeTable.data();
+	options.maxAge = maxAge;
+
+	const bool layered = compositing == Compositing::LAYERED;
+	const CameraLayer camera = layered ? cameraLayer : CameraLayer::FULL;
+	if(layered)
+	{
+		options.fadeTable = OPAQUE_FADE_TABLE;
+		options.maxAge = 0;
+	}
+
+	// The kernels write the full camera, a decimated one is done here
+	const bool halfRateFrame = (frameCount++ & 1) == 0;
+	const bool fullCamera = camera == CameraLayer::FULL || (camera == CameraLayer::HALF_RATE && halfRateFrame);
+	const bool decimated = camera == CameraLayer::DECIMATED;
+	const int cameraWidth = CameraWidth();
+	cameraChanged = fullCamera || decimated;
+
+	// Only the windows are looked for light in, the rest of a row that is
+	// written to the image is copied without. When nothing is written, a
+	// full scan first finds the brightest pixel of every small tile and only
+	// looks closer at tiles that reach the threshold.
+	PredictWindows();
+	PixelKernelOptions copyOptions = options;
+	copyOptions.draw = false;
+	const bool skipDarkTiles = !fullCamera && windows.empty() && options.draw;
+
+	auto processBand = [&](int index)
+	{
+		Band& band = bands[index];
+		int* lit = litColumns.data() + (size_t)index * width;
+		band.thresholded = 0;
+		band.maskRows.clear();
+		band.maskLeft = width;
+		band.maskRight = -1;
+		for(int i = band.firstRow; i < band.endRow; i++)
+		{
+			const uint32_t* src = pixels + (size_t)i * width;
+			uint16_t* stamps = litStamps.Data() + (size_t)i * width;
+			uint8_t* dst = fullCamera ? camPixels.Data() + (size_t)i * width * 4 : nullptr;
+
+			band.spans.clear();
+			if(skipDarkTiles)
+			{
+				if((i - band.firstRow) % BRIGHT_TILE_SIZE == 0)
+				{
+					tileMaxKernel(src, width, width, std::min(BRIGHT_TILE_SIZE, band.endRow - i), band.tileMax.data());
+					band.brightSpans.clear();
+					for(int t = 0; t < (int)band.tileMax.size(); t++)
+					{
+						if(band.tileMax[t] >= options.threshold)
+							band.brightSpans.push_back({ t * BRIGHT_TILE_SIZE, std::min((t + 1) * BRIGHT_TILE_SIZE, width) });
+					}
+				}
+				band.spans.assign(band.brightSpans.begin(), band.brightSpans.end());
+			}
+			else if(windows.empty())
+				band.spans.push_back({ 0, width });
+
+			for(const Window& window : windows)
+			{
+				if(i >= window.top && i < window.bottom)
+					band.spans.push_back({ window.left, window.right });
+			}
+			std::sort(band.spans.begin(), band.spans.end(), [](const Span& a, const Span& b) { return a.begin < b.begin; });
+
+			int numLit = 0;
+			int copied = 0;
+			for(size_t s = 0; s < band.spans.size(); s++)
+			{
+				// Overlapping windows are scanned once
+				Span span = band.spans[s];
+				span.begin = std::max(span.begin, copied);
+				while(s + 1 < band.spans.size() && band.spans[s + 1].begin <= span.end)
+					span.end = std::max(span.end, band.spans[++s].end);
+				if(span.begin >= span.end)
+					continue;
+
+				if(dst && copied < span.begin)
+					kernel(src + copied, stamps + copied, dst + copied * 4, span.begin - copied, copyOptions, lit + numLit);
+
+				int found = kernel(src + span.begin, stamps + span.begin, dst ? dst + span.begin * 4 : nullptr, span.end - span.begin, options, lit + numLit);
+				for(int k = numLit; k < numLit + found; k++)
+					lit[k] += span.begin;
+				numLit += found;
+				band.thresholded += span.end - span.begin;
+				copied = span.end;
+			}
+			if(dst && copied < width)
+				kernel(src + copied, stamps + copied, dst + copied * 4, width - copied, copyOptions, lit + numLit);
+
+			labeler.AddRow(index, i, lit, numLit);
+
+			if(decimated && i % 2 == 0 && i / 2 < CameraHeight())
+				DecimateRow(src, camPixels.Data() + (size_t)(i / 2) * cameraWidth * 4, cameraWidth);
+
+			// The cell row's lit pixels as bits, a row of words per pixel row
+			if(numLit > 0)
+			{
+				uint64_t* mask = band.litMask.data() + (size_t)(i % cellSize) * maskWords;
+				std::fill(mask, mask + maskWords, 0);
+				for(int k = 0; k < numLit; k++)
+					mask[lit[k] / 64] |= 1ull << (lit[k] % 64);
+				for(int w = lit[0] / 64; w <= lit[numLit - 1] / 64; w++)
+					band.anyMask[w] |= mask[w];
+
+				band.maskRows.push_back(i % cellSize);
+				band.maskLeft = std::min(band.maskLeft, lit[0]);
+				band.maskRight = std::max(band.maskRight, lit[numLit - 1]);
+			}
+
+			// Once the cell row is done, every cell the light reached gets its
+			// bits counted. Only the set bits of all its rows together are
+			// visited, a cell at a time. Grid rows start on a word of their own,
+			// so every band seeds its rows straight into the grid.
+			if((i % cellSize == cellSize - 1 || i == band.endRow - 1) && !band.maskRows.empty())
+			{
+				const int gridRow = i / cellSize;
+				int counted = 0;	// Columns before this are in cells already counted
+				for(int w = band.maskLeft / 64; w <= band.maskRight / 64; w++)
+				{
+					uint64_t bits = band.anyMask[w];
+					band.anyMask[w] = 0;
+					if(counted > w * 64)
+						bits &= counted >= (w + 1) * 64 ? 0 : ~0ull << (counted - w * 64);
+
+					while(bits)
+					{
+						int c = (w * 64 + LowestBit(bits)) / cellSize;
+						int begin = c * cellSize;
+						int end = std::min(begin + cellSize, width);
+
+						int count = minLitPerCell;	// One lit pixel is enough then
+						if(minLitPerCell > 1)
+						{
+							count = 0;
+							for(int r : band.maskRows)
+								count += CountBits(band.litMask.data() + (size_t)r * maskWords, begin, end);
+						}
+						if(count >= minLitPerCell)
+						{
+							grid.Set(gridRow, c);
+							sparseLife.Touch(gridRow, c);
+						}
+
+						counted = end;
+						bits &= end >= (w + 1) * 64 ? 0 : ~0ull << (end - w * 64);
+					}
+				}
+
+				band.maskRows.clear();
+				band.maskLeft = width;
+				band.maskRight = -1;
+			}
+
+			if(layered)
+			{
+				std::atomic<uint8_t>* tileRow = tileLit.data() + (size_t)(i / TILE_SIZE) * tileColumns;
+				for(int k = 0; k < numLit; k++)
+				{
+					std::atomic<uint8_t>& tile = tileRow[lit[k] / TILE_SIZE];
+					if(!tile.load(std::memory_order_relaxed))
+						tile.store(1, std::memory_order_relaxed);
+				}
+			}
+		}
+	};
+
+	labeler.Begin((int)bands.size());
+	if(workers)
+		workers->Run((int)bands.size(), processBand, "band");
+	else
+	{
+		for(int b = 0; b < (int)bands.size(); b++)
+			processBand(b);
+	}
+
+	labeler.Finish();
+
+	int64_t thresholded = 0;
+	for(const Band& band : bands)
+		thresholded += band.thresholded;
+	thresholdedFraction = (double)thresholded / ((double)width * height);
+
+	// Strokes are drawn after the image was written, so in COMBINED they also
+	// fix up the alpha of the pixels they cover
+	if(options.draw && (mode == DrawMode::STROKE || roi))
+		tracker.Update(labeler.Blobs());
+	else
+		tracker.Reset();
+
+	if(mode == DrawMode::STROKE)
+	{
+		for(const StrokeSegment& segment : tracker.Segments())
+			DrawStroke(segment, layered);
+	}
+
+	if(layered)
+		UpdateDrawing(options.elapsed, options.punch);
+}
+
+void Canvas::UpdateDrawing(uint16_t elapsed, bool punch)
+{
+	const uint16_t now = (uint16_t)fadeClock;
+
+	redraw.clear();
+	for(size_t t = 0; t < tiles.size(); t++)
+	{
+		Tile& tile = tiles[t];
+		bool wasFading = (uint16_t)(drawnAt - tile.newest) < maxAge;
+
+		// Lit pixels that are not punched keep their age, so the tile does too
+		bool lit = tileLit[t].load(std::memory_order_relaxed) != 0;
+		if(lit)
+		{
+			tile.newest = punch ? now : (uint16_t)(tile.newest + elapsed);
+			tileLit[t].store(0, std::memory_order_relaxed);
+		}
+
+		bool stroked = tile.stroked;
+		if(stroked)
+		{
+			tile.newest = now;
+			tile.stroked = false;
+		}
+
+		if(redrawAll || stroked || (lit && punch) || (wasFading && now != drawnAt))
+			redraw.push_back((int)t);
+	}
+	redrawAll = false;
+	drawnAt = now;
+	numRedrawn = (int)redraw.size();
+
+	auto drawTile = [&](int index)
+	{
+		Tile& tile = tiles[redraw[index]];
+		uint8_t* dst = tile.pixels.Data();
+		for(int i = 0; i < tile.height; i++)
+		{
+			const uint16_t* stamps = litStamps.Data() + (size_t)(tile.y + i) * width + tile.x;
+			for(int j = 0; j < tile.width; j++, dst += 4)
+			{
+				uint16_t age = std::min((uint16_t)(now - stamps[j]), maxAge);
+				dst[0] = 255;
+				dst[1] = 255;
+				dst[2] = 255;
+				dst[3] = (uint8_t)(255 - (fadeTable[age] >> 24));
+			}
+		}
+		tile.dirty = true;
+	};
+
+	if(workers)
+		workers->Run(numRedrawn, drawTile, "drawing tile");
+	else
+	{
+		for(int i = 0; i < numRedrawn; i++)
+			drawTile(i);
+	}
+}
+
+void Canvas::SetRegionOfInterest(bool enabled, int interval)
+{
+	roi = enabled;
+	fullScanInterval = std::max(interval, 1);
+	framesSinceFullScan = 0;
+}
+
+void Canvas::PredictWindows()
+{
+	windows.clear();
+
+	// Nothing to follow, or something got lost, or it is time to look for new lights
+	const std::vector<Track>& tracks = tracker.Tracks();
+	bool lost = std::any_of(tracks.begin(), tracks.end(), [](const Track& track) { return track.missed > 0; });
+	if(!roi || tracks.empty() || lost || ++framesSinceFullScan >= fullScanInterval)
+	{
+		framesSinceFullScan = 0;
+		return;
+	}
+
+	// Faster lights are harder to predict, so they get more room
+	for(const Track& track : tracks)
+	{
+		float x = track.x + track.vx;
+		float y = track.y + track.vy;
+		float reach = 2.0f * track.radius + 0.5f * std::hypot(track.vx, track.vy) + ROI_MARGIN;
+
+		Window window;
+		window.left = std::max((int)std::floor(x - reach), 0);
+		window.top = std::max((int)std::floor(y - reach), 0);
+		window.right = std::min((int)std::ceil(x + reach) + 1, width);
+		window.bottom = std::min((int)std::ceil(y + reach) + 1, height);
+		if(window.left < window.right && window.top < window.bottom)
+			windows.push_back(window);
+	}
+}
+
+// Narrows [xmin, xmax] to the x where offset + coefficient * x is in [low, high]
+static void RestrictSpan(float coefficient, float offset, float low, float high, float& xmin, float& xmax)
+{
+	if(std::fabs(coefficient) < 1e-6f)
+	{
+		if(offset < low || offset > high)
+		{
+			xmin = 1.0f;
+			xmax = 0.0f;
+		}
+		return;
+	}
+
+	float a = (low - offset) / coefficient;
+	float b = (high - offset) / coefficient;
+	xmin = std::max(xmin, std::min(a, b));
+	xmax = std::min(xmax, std::max(a, b));
+}
+
+void Canvas::DrawStroke(const StrokeSegment& segment, bool layered)
+{
+	const uint16_t now = (uint16_t)fadeClock;
+
+	// Pixel centres closer than reach are at least partly covered
+	const float radius = std::max(segment.radius, 1.0f);
+	const float reach = radius + 0.5f;
+	const float dx = segment.x1 - segment.x0;
+	const float dy = segment.y1 - segment.y0;
+	const float lengthSquared = dx * dx + dy * dy;
+	const float length = std::sqrt(lengthSquared);
+
+	// Clamped while still floats, one outside the range of int has no int to convert to
+	float topEdge = std::max(std::min(segment.y0, segment.y1) - reach, 0.0f);
+	float bottomEdge = std::min(std::max(segment.y0, segment.y1) + reach, (float)(height - 1));
+	if(!(topEdge <= bottomEdge))
+		return;
+
+	int top = (int)std::ceil(topEdge);
+	int bottom = (int)std::floor(bottomEdge);
+	for(int i = top; i <= bottom; i++)
+	{
+		const float y = (float)i;
+
+		// The row crosses the line with round ends in one span: the union of
+		// where it crosses either end's circle and the rectangle in between
+		float left = 1e30f;
+		float right = -1e30f;
+		const float ends[2][2] = { { segment.x0, segment.y0 }, { segment.x1, segment.y1 } };
+		for(const auto& end : ends)
+		{
+			float h = reach * reach - (y - end[1]) * (y - end[1]);
+			if(h >= 0.0f)
+			{
+				left = std::min(left, end[0] - std::sqrt(h));
+				right = std::max(right, end[0] + std::sqrt(h));
+			}
+		}
+		if(length > 0.0f)
+		{
+			float ux = dx / length;
+			float uy = dy / length;
+			float xmin = -1e30f;
+			float xmax = 1e30f;
+			RestrictSpan(ux, (y - segment.y0) * uy - segment.x0 * ux, 0.0f, length, xmin, xmax);
+			RestrictSpan(-uy, (y - segment.y0) * ux + segment.x0 * uy, -reach, reach, xmin, xmax);
+			if(xmin <= xmax)
+			{
+				left = std::min(left, xmin);
+				right = std::max(right, xmax);
+			}
+		}
+
+		left = std::max(left, 0.0f);
+		right = std::min(right, (float)(width - 1));
+		if(left > right)
+			continue;
+
+		int first = (int)std::ceil(left);
+		int last = (int)std::floor(right);
+		if(first > last)
+			continue;
+
+		uint16_t* stamps = litStamps.Data() + (size_t)i * width;
+		uint8_t* image = camPixels.Data() + (size_t)i * width * 4;
+		for(int j = first; j <= last; j++)
+		{
+			// Distance to the nearest point of the segment
+			float px = j - segment.x0;
+			float py = y - segment.y0;
+			float t = lengthSquared > 0.0f ? std::min(std::max((px * dx + py * dy) / lengthSquared, 0.0f), 1.0f) : 0.0f;
+			float distance = std::hypot(px - t * dx, py - t * dy);
+
+			float coverage = std::min(reach - distance, 1.0f);
+			if(coverage <= 0.0f)
+				continue;
+
+			// Only ever makes a pixel younger
+			uint16_t age = ageByCoverage[(int)(coverage * 255.0f + 0.5f)];
+			if(age >= std::min((uint16_t)(now - stamps[j]), maxAge))
+				continue;
+
+			stamps[j] = (uint16_t)(now - age);
+			if(!layered)
+				image[j * 4 + 3] = (uint8_t)(fadeTable[age] >> 24);
+		}
+
+		if(layered)
+		{
+			Tile* tileRow = tiles.data() + (size_t)(i / TILE_SIZE) * tileColumns;
+			for(int x = first / TILE_SIZE; x <= last / TILE_SIZE; x++)
+				tileRow[x].stroked = true;
+		}
+	}
+}
+
+void Canvas::UploadDrawing(sf::Texture& texture)
+{
+	for(Tile& tile : tiles)
+	{
+		if(tile.dirty)
+		{
+			texture.update(tile.pixels.Data(), tile.width, tile.height, tile.x, tile.y);
+			tile.dirty = false;
+		}
+	}
+}
+
+void Canvas::CopyDrawing(uint8_t* rgba) const
+{
+	for(const Tile& tile : tiles)
+	{
+		for(int i = 0; i < tile.height; i++)
+		{
+			const uint8_t* src = tile.pixels.Data() + (size_t)i * tile.width * 4;
+			std::copy(src, src + tile.width * 4, rgba + ((size_t)(tile.y + i) * width + tile.x) * 4);
+		}
+	}
+}
+
+void Canvas::SetCompositing(Compositing mode)
+{
+	compositing = mode;
+	redrawAll = true;
+}
+
+void Canvas::SetCameraLayer(CameraLayer layer)
+{
+	cameraLayer = layer;
+}
+
+int Canvas::CameraWidth() const
+{
+	bool decimated = compositing == Compositing::LAYERED && cameraLayer == CameraLayer::DECIMATED;
+	return decimated ? width / 2 : width;
+}
+
+int Canvas::CameraHeight() const
+{
+	bool decimated = compositing == Compositing::LAYERED && cameraLayer == CameraLayer::DECIMATED;
+	return decimated ? height / 2 : height;
+}
+
+void Canvas::SetFadeCurve(FadeCurve curve)
+{
+	SetFadeTable(BuildFadeTable(curve));
+}
+
+void Canvas::SetFadeTable(const std::vector<uint8_t>& alphaByAge)
+{
+	if(alphaByAge.empty() || alphaByAge.size() > MAX_FADE_TICKS)
+		return;
+
+	uint16_t oldMaxAge = maxAge;
+	fadeTable.resize(alphaByAge.size());
+	for(size_t i = 0; i < alphaByAge.size(); i++)
+		fadeTable[i] = (uint32_t)alphaByAge[i] << 24;
+	maxAge = (uint16_t)(alphaByAge.size() - 1);
+	redrawAll = true;
+
+	// A pixel a stroke only partly covers is drawn as if it was lit a while ago,
+	// with as much of the trail's strength as the stroke covers of it
+	int strongest = 255 - alphaByAge[0];
+	uint16_t age = 0;
+	for(int coverage = 255; coverage >= 0; coverage--)
+	{
+		int strength = (strongest * coverage + 127) / 255;
+		while(age < maxAge && 255 - alphaByAge[age] > strength)
+			age++;
+		ageByCoverage[coverage] = age;
+	}
+
+	// Pixels that had finished fading must not reappear partway along a longer table
+	if(litStamps.Size())
+		ClampStamps(std::min(oldMaxAge, maxAge));
+}
+
+void Canvas::AdvanceFadeClock(uint32_t ticks)
+{
+	// Stamps are only 16 bits. Clamping them every MAX_FADE_TICKS keeps every
+	// age below 2^16, as long as no single step is longer than the whole fade.
+	fadeClock += ticks;
+	ticksSinceClamp += ticks;
+	if(ticksSinceClamp >= MAX_FADE_TICKS)
+	{
+		ClampStamps(maxAge);
+		ticksSinceClamp = 0;
+	}
+}
+
+void Canvas::CleanSpareGrid(size_t maxWords)
+{
+	size_t end = std::min(spareClean + maxWords, spareGrid.NumWords());
+	if(spareClean < end)
+		std::fill(spareGrid.Words() + spareClean, spareGrid.Words() + end, 0);
+	spareClean = end;
+}
+
+void Canvas::ClampStamps(uint16_t fromAge)
+{
+	uint16_t now = (uint16_t)fadeClock;
+	uint16_t faded = (uint16_t)(now - maxAge);
+	uint16_t* stamps = litStamps.Data();
+	for(size_t i = 0; i < litStamps.Size(); i++)
+	{
+		if((uint16_t)(now - stamps[i]) >= fromAge)
+			stamps[i] = faded;
+	}
+
+	for(Tile& tile : tiles)
+	{
+		if((uint16_t)(now - tile.newest) >= fromAge)
+			tile.newest = faded;
+	}
+}
+
+void Canvas::SetKernelIsa(KernelIsa isa)
+{
+	kernelIsa = KernelIsaSupported(isa) ? isa : KernelIsa::SCALAR;
+	kernel = GetPixelRowKernel(kernelIsa);
+	tileMaxKernel = GetTileMaxKernel(kernelIsa);
+}
+
+void Canvas::SetLifeIsa(LifeIsa isa)
+{
+	lifeIsa = LifeIsaSupported(isa) ? isa : LifeIsa::SCALAR;
+	lifeKernel = GetLifeRowKernel(lifeIsa);
+}
+
+void Canvas::SetLifeEngine(LifeEngine engine)
+{
+	lifeEngine = engine;
+	universe.Clear();
+	sparseLife.TouchAll();
+}
+
+void Canvas::SetBoundary(Boundary newBoundary)
+{
+	// The cells along the edges have new neighbours
+	boundary = newBoundary;
+	sparseLife.TouchAll();
+}
+
+void Canvas::SetFastForward(int log2Generations)
+{
+	fastForward = std::min(std::max(log2Generations, 0), (int)HashLife::MAX_STEP_LOG);
+}
+
+void Canvas::BuildGridVertices()
+{
+	gridVertices.clear();
+	for(int i = 0; i < rows; i++)
+	{
+		// Only the live cells, straight from the set bits
+		const uint64_t* row = grid.Row(i);
+		for(int w = 0; w * 64 < columns; w++)
+		{
+			for(uint64_t bits = row[w]; bits; bits &= bits - 1)
+			{
+				int j = w * 64 + LowestBit(bits);
+				if(j >= columns)
+					break;
+
+				sf::Vector2f pos(j * (float)cellSize, i * (float)cellSize);
+				gridVertices.append(sf::Vertex(pos + cell.getPoint(0), sf::Color(255, 255, 255, 100)));
+				gridVertices.append(sf::Vertex(pos + cell.getPoint(1), sf::Color(255, 255, 255, 100)));
+				gridVertices.append(sf::Vertex(pos + cell.getPoint(2), sf::Color(255, 255, 255, 100)));
+				gridVertices.append(sf::Vertex(pos + cell.getPoint(3), sf::Color(255, 255, 255, 100)));
+			}
+		}
+	}
+}
+
+void Canvas::StepAutomaton(DrawMode mode)
+{
+	if(mode == DrawMode::GAME_OF_LIFE && lifeEngine == LifeEngine::HASHLIFE)
+	{
+		// Whatever was lit this frame goes into the universe, and the grid
+		// shows the part of it on screen again once it stepped
+		universe.Write(grid);
+		universe.Step(fastForward);
+		universe.Read(grid);
+	}
+	else if(mode == DrawMode::GAME_OF_LIFE && lifeEngine == LifeEngine::SPARSE)
+	{
+		sparseLife.Step(grid, nextGrid, lifeKernel, workers, boundary);
+		grid.Swap(nextGrid);
+	}
+	else if(mode == DrawMode::GAME_OF_LIFE)
+	{
+		// The new generation is swapped in, not copied
+		StepLife(grid, nextGrid, lifeKernel, workers, boundary);
+		grid.Swap(nextGrid);
+	}
+	else if(mode == DrawMode::SAND)
+	{
+		// Grains fall one cell at a time, which is no good for packed bits
+		sandCells.assign((size_t)rows * columns, false);
+		for(int i = 0; i < rows; i++)
+		for(int j = 0; j < columns; j++)
+			sandCells[(size_t)i * columns + j] = grid.Get(i, j);
+
+		IterateCellularAutomata(sandCells, rows, columns, mode, boundary);
+
+		for(int i = 0; i < rows; i++)
+		{
+			uint64_t* row = grid.Row(i);
+			std::fill(row, row + grid.RowWords(), 0);
+			for(int j = 0; j < columns; j++)
+			{
+				if(sandCells[(size_t)i * columns + j])
+					grid.Set(i, j);
+			}
+		}
+		sparseLife.TouchAll();
+	}
+}
+
+void Canvas::Clear(bool trail)
+{
+	if(!trail)
+	{
+		// Clear drawn image: every pixel is now at least as old as the whole fade
+		AdvanceFadeClock(maxAge + 1);
+	}
+
+	// Clear grid, finishing the spare first if this comes quickly after the last clear
+	CleanSpareGrid(spareGrid.NumWords());
+	grid.Swap(spareGrid);
+	spareClean = 0;
+	universe.Clear();
+	sparseLife.TouchAll();
+}
@@ -0,0 +1,318 @@
+#pragma once
+#include "AlignedBuffer.hpp"
+#include "BlobLabeler.hpp"
+#include "BlobTracker.hpp"
+#include "BitGrid.hpp"
+#include "CellularAutomata.hpp"
+#include "HashLife.hpp"
+#include "LifeKernels.hpp"
+#include "PixelKernels.hpp"
+#include "SparseLife.hpp"
+#include "WorkerPool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include <SFML/Graphics.hpp>
+
+const int TRESHOLD = 255;
+
+// How the alpha of a lit pixel goes back to opaque once the light moved on
+enum class FadeCurve
+{
+	LINEAR,	// 3 per tick, the original trail
+	EXPONENTIAL	// Quick at first, with a long faint tail
+};
+
+// How the trail reaches the screen
+enum class Compositing
+{
+	COMBINED,	// One image, the trail in the camera's alpha
+	LAYERED	// The camera opaque, the drawing in a texture of its own on top, redrawn and uploaded per tile
+};
+
+// How much of the camera the LAYERED canvas keeps showing. Light is always
+// looked for in every pixel of every frame, this is only about the picture.
+enum class CameraLayer
+{
+	FULL,
+	HALF_RATE,	// Every other frame
+	DECIMATED,	// Every other pixel of every other row, to be drawn scaled up 2x
+	DISABLED	// Only the drawing
+};
+
+// What steps GAME_OF_LIFE
+enum class LifeEngine
+{
+	PACKED,	// The grid on screen, 64 cells to a word
+	SPARSE,	// The same, but only the tiles where something changed
+	HASHLIFE	// A universe without edges with the grid as a window into it, which can fast-forward
+};
+
+// Everything that gets drawn: the camera image as tightly packed RGBA bytes,
+// with the trail in its alpha channel, and the cell grid used by GAME_OF_LIFE
+// and SAND. Shared by the program and the benchmark so both run exactly the
+// same per-frame work.
+//
+// The trail is not faded pixel by pixel every frame. Every pixel remembers the
+// tick of the fade clock it was last lit at, and its alpha is looked up from
+// that age while the image is written anyway. The clock only runs while the
+// trail is on, which is what keeps the drawing when it is off.
+class Canvas
+{
+public:
+	Canvas(int width, int height, int cellSize);
+
+	// Copies a camera frame into the image, draws where the light is, fades the
+	// trail and seeds the grid. Runs in row bands on the worker pool if there is one.
+	// time is the frame's timestamp in seconds, it drives the fade.
+	void ProcessFrame(const uint32_t* pixels, double time, DrawMode mode, bool trail);
+
+	// Bright regions of the last frame ProcessFrame saw
+	const std::vector<Blob>& Blobs() const { return labeler.Blobs(); }
+
+	// Lights followed across frames, only in STROKE. STROKE draws the line every
+	// light moved along since the previous frame instead of the pixels that were
+	// lit, so a fast light leaves a solid line rather than a row of dots.
+	const std::vector<Track>& Tracks() const { return tracker.Tracks(); }
+
+	// With a region of interest, light is only looked for in a window around
+	// where every tracked light is heading. The whole frame is still scanned
+	// every fullScanInterval frames, and whenever a light went missing, to
+	// find new ones. Pixels outside the windows are still copied when the
+	// camera image is written, just not tested.
+	static const int FULL_SCAN_INTERVAL = 30;
+	void SetRegionOfInterest(bool enabled, int fullScanInterval = FULL_SCAN_INTERVAL);
+	bool GetRegionOfInterest() const { return roi; }
+
+	// Fraction of the frame's pixels the last ProcessFrame looked for light in
+	double ThresholdedFraction() const { return thresholdedFraction; }
+
+	// Rebuilds the quads for every live cell
+	void BuildGridVertices();
+
+	void StepAutomaton(DrawMode mode);
+
+	// Which Life kernel StepAutomaton uses, the best supported one by default
+	void SetLifeIsa(LifeIsa isa);
+	LifeIsa GetLifeIsa() const { return lifeIsa; }
+
+	// PACKED by default. Switching starts the universe over from the grid.
+	void SetLifeEngine(LifeEngine engine);
+	LifeEngine GetLifeEngine() const { return lifeEngine; }
+
+	// What GAME_OF_LIFE and SAND find past the edges of the grid, TORUS by
+	// default. HASHLIFE has no edges to find.
+	void SetBoundary(Boundary boundary);
+	Boundary GetBoundary() const { return boundary; }
+
+	// HASHLIFE steps 2^log2Generations generations every frame, 1 by default.
+	// PACKED always steps one.
+	void SetFastForward(int log2Generations);
+	int GetFastForward() const { return fastForward; }
+
+	// What HASHLIFE steps, cells written into it from the grid and read back
+	const HashLife& Universe() const { return universe; }
+
+	// Tiles of the grid SPARSE stepped last, and how many there are
+	int ActiveLifeTiles() const { return sparseLife.ActiveTiles(); }
+	int NumLifeTiles() const { return sparseLife.NumTiles(); }
+
+	// How many pixels of a cell have to be lit for it to come alive, 1 by
+	// default. More keeps stray bright pixels and noise out of the grid.
+	void SetMinLitPerCell(int minLit) { minLitPerCell = std::max(minLit, 1); }
+	int GetMinLitPerCell() const { return minLitPerCell; }
+
+	// Not owned, nullptr processes the whole frame on the calling thread
+	void SetWorkerPool(WorkerPool* pool) { workers = pool; }
+
+	// Which pixel kernel ProcessFrame uses, the best supported one by default
+	void SetKernelIsa(KernelIsa isa);
+	KernelIsa GetKernelIsa() const { return kernelIsa; }
+
+	static const int FADE_TICKS_PER_SECOND = 60;
+	static const int MAX_FADE_TICKS = 16384;
+
+	void SetFadeCurve(FadeCurve curve);
+
+	// Alpha for every age in ticks, starting right after the pixel was lit. The
+	// last entry holds from then on, so it should be 255. At most MAX_FADE_TICKS entries.
+	void SetFadeTable(const std::vector<uint8_t>& alphaByAge);
+
+	// In LAYERED, Pixels() is the opaque camera image, and the drawing is kept in
+	// TILE_SIZE squares. Only tiles where something was lit or is still fading
+	// are redrawn and uploaded, a drawing that has faded away costs nothing.
+	static const int TILE_SIZE = 64;
+
+	void SetCompositing(Compositing mode);
+	Compositing GetCompositing() const { return compositing; }
+
+	// Only honoured when LAYERED, a COMBINED canvas always shows the full camera
+	void SetCameraLayer(CameraLayer layer);
+	CameraLayer GetCameraLayer() const { return cameraLayer; }
+
+	// Size of the camera image in Pixels()
+	int CameraWidth() const;
+	int CameraHeight() const;
+
+	// Whether the last ProcessFrame wrote Pixels(), nothing needs uploading otherwise
+	bool CameraChanged() const { return cameraChanged; }
+
+	// Uploads every drawing tile that changed since the last call, into a
+	// Width() x Height() texture. The drawing is white, its alpha is how much of
+	// the background shows over the camera.
+	void UploadDrawing(sf::Texture& texture);
+
+	// The whole drawing as it would be uploaded, Width() x Height() RGBA
+	// bytes, without marking any tile uploaded
+	void CopyDrawing(uint8_t* rgba) const;
+
+	// Drawing tiles redrawn by the last ProcessFrame
+	int RedrawnTiles() const { return numRedrawn; }
+	int NumTiles() const { return (int)tiles.size(); }
+
+	// Wipes the grid, and the drawing too when it is not fading away by itself.
+	// Usually takes no time worth mentioning: the drawing is wiped by moving the
+	// fade clock past every stamp, and the grid by swapping in a spare one that
+	// was cleaned bit by bit over the previous frames. Some clears walk a whole
+	// buffer anyway: one that brings the fade clock to MAX_FADE_TICKS since the
+	// last clamp clamps every stamp, and one that comes before the spare grid
+	// was clean finishes cleaning it. SPARSE then wakes every tile and HASHLIFE
+	// forgets its universe, which both grow with the grid.
+	void Clear(bool trail);
+
+	int Width() const { return width; }
+	int Height() const { return height; }
+	int CellSize() const { return cellSize; }
+	const uint8_t* Pixels() const { return camPixels.Data(); }
+	const sf::VertexArray& GridVertices() const { return gridVertices; }
+
+private:
+	int width;
+	int height;
+
+	// Redraws the drawing tiles that were lit or are still fading
+	void UpdateDrawing(uint16_t elapsed, bool punch);
+
+	// Moves the fade clock on, clamping old stamps whenever they could wrap
+	void AdvanceFadeClock(uint32_t ticks);
+
+	// Cleans up to maxWords more words of the spare grid
+	void CleanSpareGrid(size_t maxWords);
+
+	// Windows around where the tracked lights will be in the next frame
+	void PredictWindows();
+
+	// Stamps an anti-aliased line with round ends into the drawing. Only
+	// the pixels under it are visited, one span per row.
+	void DrawStroke(const StrokeSegment& segment, bool layered);
+
+	// Makes every stamp at least fromAge old as old as the fade table is long,
+	// so it shows fully faded and will not come back when the clock wraps
+	void ClampStamps(uint16_t fromAge);
+
+	AlignedBuffer<uint8_t> camPixels;
+	AlignedBuffer<uint16_t> litStamps;	// Fade clock tick every pixel was last lit at
+
+	std::vector<uint32_t> fadeTable;	// Alpha by age, shifted into the top byte for the kernels
+	uint16_t ageByCoverage[256];	// Youngest age that shows no more than a partly covered pixel should
+	uint16_t maxAge = 0;
+	uint32_t fadeClock = 0;
+	int64_t lastTick = -1;
+	uint32_t ticksSinceClamp = 0;
+
+	// The drawing layer, row after row of tiles
+	struct Tile
+	{
+		int x;
+		int y;
+		int width;
+		int height;
+		uint16_t newest;	// Stamp of the youngest pixel, or at least as young
+		bool dirty;	// Redrawn but not uploaded yet
+		bool stroked;	// A stroke went through it this frame
+		AlignedBuffer<uint8_t> pixels;	// width x height RGBA, packed for sf::Texture::update
+	};
+
+	Compositing compositing = Compositing::COMBINED;
+	CameraLayer cameraLayer = CameraLayer::FULL;
+	bool cameraChanged = false;
+	uint64_t frameCount = 0;
+	std::vector<Tile> tiles;
+	int tileColumns;
+	std::vector<std::atomic<uint8_t>> tileLit;	// Bands can share a tile
+	std::vector<int> redraw;
+	int numRedrawn = 0;
+	uint16_t drawnAt = 0;	// Fade clock the drawing was last brought up to
+	bool redrawAll = true;
+
+	KernelIsa kernelIsa;
+	PixelRowKernel kernel;
+	TileMaxKernel tileMaxKernel;
+
+	// Region of interest
+	struct Window
+	{
+		int left;
+		int top;
+		int right;	// Exclusive
+		int bottom;
+	};
+
+	struct Span
+	{
+		int begin;
+		int end;	// Exclusive
+	};
+
+	bool roi = false;
+	int fullScanInterval = FULL_SCAN_INTERVAL;
+	int framesSinceFullScan = 0;
+	std::vector<Window> windows;	// Empty scans the whole frame
+	double thresholdedFraction = 1.0;
+
+	// Bands are whole cell rows, so no two bands ever seed the same grid row
+	struct Band
+	{
+		int firstRow = 0;
+		int endRow = 0;
+		int64_t thresholded = 0;	// Pixels looked for light in
+		std::vector<Span> spans;	// Of the row being processed, where the windows cross it or its tiles are bright
+		std::vector<uint8_t> tileMax;	// Of the BRIGHT_TILE_SIZE rows being processed
+		std::vector<Span> brightSpans;	// Tiles of those rows that reach the threshold
+		std::vector<uint64_t> litMask;	// Lit pixels of the cell row being processed, maskWords per pixel row
+		std::vector<uint64_t> anyMask;	// Every row of litMask ORed together
+		std::vector<int> maskRows;	// Pixel rows of the cell row that have any
+		int maskLeft = 0;	// Leftmost and rightmost lit column in them
+		int maskRight = 0;
+	};
+
+	WorkerPool* workers = nullptr;
+	std::vector<Band> bands;
+	BlobLabeler labeler;	// Fed by the bands, one band each
+	BlobTracker tracker;
+	std::vector<int> litColumns;	// width per band
+	int maskWords;	// 64 pixels each
+	int minLitPerCell = 1;
+
+	// Game of life grid
+	int cellSize;
+	int columns;
+	int rows;
+	BitGrid grid;
+	BitGrid nextGrid;	// The generation being stepped to, swapped in when done
+	BitGrid spareGrid;	// Swapped in by Clear()
+	size_t spareClean;	// Words at the start of spareGrid that are known to be zero
+	LifeIsa lifeIsa;
+	LifeRowKernel lifeKernel;
+	std::vector<bool> sandCells;	// The grid unpacked, for SAND
+	LifeEngine lifeEngine = LifeEngine::PACKED;
+	Boundary boundary = Boundary::TORUS;
+	HashLife universe;
+	SparseLife sparseLife;	// Told about every cell set outside of a step
+	int fastForward = 0;
+
+	// Game of life cell
+	sf::VertexArray gridVertices;
+	sf::RectangleShape cell;
+};
@@ -0,0 +1,76 @@
+#include "CaptureRing.hpp"
+#include "Trace.hpp"
+
+CaptureRing::CaptureRing(FrameSource& source, bool lossless)
+	: source(source), lossless(lossless)
+{
+	for(Slot& slot : slots)
+		slot.storage.resize((size_t)source.Width() * source.Height());
+}
+
+CaptureRing::~CaptureRing()
+{
+	Stop();
+}
+
+void CaptureRing::Start()
+{
+	if(thread.joinable())
+		return;
+
+	running = true;
+	thread = std::thread(&CaptureRing::CaptureLoop, this);
+}
+
+void CaptureRing::Stop()
+{
+	running = false;
+	if(thread.joinable())
+		thread.join();
+}
+
+const Frame* CaptureRing::Latest()
+{
+	if(shared.load(std::memory_order_acquire) & FRESH)
+		front = shared.exchange(front, std::memory_order_acq_rel) & ~FRESH;
+
+	const Frame& frame = slots[front].frame;
+	return frame.pixels ? &frame : nullptr;
+}
+
+void CaptureRing::CaptureLoop()
+{
+	TraceSetThreadName("capture");
+
+	uint64_t sequence = 0;
+	while(running.load(std::memory_order_relaxed))
+	{
+		Slot& slot = slots[back];
+		{
+			TraceScope scope("next frame");
+			if(!source.NextFrame(slot.frame, slot.storage.data()))
+				break;
+		}
+
+		slot.frame.width = source.Width();
+		slot.frame.height = source.Height();
+		slot.frame.sequence = sequence++;
+
+		if(sink)
+		{
+			TraceScope scope("submit");
+			sink->Submit(slot.frame);
+		}
+
+		while(lossless && (shared.load(std::memory_order_acquire) & FRESH) && running.load(std::memory_order_relaxed))
+			std::this_thread::yield();
+
+		// Publish the frame and take back whatever the shared slot held
+		int previous = shared.exchange(back | FRESH, std::memory_order_acq_rel);
+		if(previous & FRESH)
+			dropped.fetch_add(1, std::memory_order_relaxed);
+		back = previous & ~FRESH;
+	}
+
+	running = false;
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include "FrameSource.hpp"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// Triple buffer filled by a dedicated capture thread. The capture thread always
+// has a slot of its own to write into and the render thread always has a slot
+// of its own to read from; the third slot holds the newest complete frame and
+// is handed over with a single atomic exchange, so neither side ever waits
+// on the other and the render thread never sees a half-written frame.
+class CaptureRing
+{
+public:
+	// A lossless ring holds the capture thread back until the render thread took
+	// the previous frame, so every frame gets processed exactly once. Meant for
+	// replays, a camera would rather drop frames.
+	explicit CaptureRing(FrameSource& source, bool lossless = false);
+	~CaptureRing();
+
+	// Every captured frame is also passed to the sink. Set before Start().
+	void SetSink(FrameSink* frameSink) { sink = frameSink; }
+
+	void Start();
+	void Stop();
+
+	// Newest complete frame, or nullptr if nothing was captured yet.
+	// Stays valid until the next call. Never blocks.
+	const Frame* Latest();
+
+	// False once the source has failed or ran out of frames. The last frame it
+	// captured may still be waiting, see HasFresh().
+	bool Running() const { return running.load(std::memory_order_acquire); }
+
+	// Whether a frame was captured that Latest() has not handed out yet
+	bool HasFresh() const { return (shared.load(std::memory_order_acquire) & FRESH) != 0; }
+
+	// Frames that were overwritten before the render thread got to them
+	uint64_t Dropped() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+	void CaptureLoop();
+
+	static const int NUM_SLOTS = 3;
+	static const int FRESH = 4;	// Set on the shared index when it holds an unread frame
+
+	struct Slot
+	{
+		std::vector<uint32_t> storage;
+		Frame frame;
+	};
+
+	FrameSource& source;
+	bool lossless;
+	FrameSink* sink = nullptr;
+	Slot slots[NUM_SLOTS];
+	int front = 0;	// Owned by the render thread
+	int back = 2;	// Owned by the capture thread
+	std::atomic<int> shared { 1 };
+
+	std::thread thread;
+	std::atomic<bool> running { false };
+	std::atomic<uint64_t> dropped { 0 };
+};
@@ -0,0 +1,99 @@
+#include "CellularAutomata.hpp"
+#include <algorithm>
+#include <cstdint>
+
+// The cells with a border of one cell all around, filled in by the boundary
+// once, so that every cell has all of its neighbours to look at
+static void PadCells(const std::vector<bool>& grid, int rows, int columns, Boundary boundary, std::vector<uint8_t>& padded)
+{
+	const int width = columns + 2;
+	padded.assign((size_t)(rows + 2) * width, 0);
+	for(int i = 0; i < rows; i++)
+	{
+		uint8_t* row = &padded[(size_t)(i + 1) * width + 1];
+		for(int j = 0; j < columns; j++)
+			row[j] = grid[(size_t)i * columns + j];
+
+		if(boundary == Boundary::TORUS)
+		{
+			row[-1] = row[columns - 1];
+			row[columns] = row[0];
+		}
+		else if(boundary == Boundary::MIRROR)
+		{
+			row[-1] = row[0];
+			row[columns] = row[columns - 1];
+		}
+	}
+
+	// The rows above and below, corners included
+	uint8_t* above = &padded[0];
+	uint8_t* below = &padded[(size_t)(rows + 1) * width];
+	if(boundary == Boundary::TORUS)
+	{
+		std::copy(below - width, below, above);
+		std::copy(above + width, above + 2 * width, below);
+	}
+	else if(boundary == Boundary::MIRROR)
+	{
+		std::copy(above + width, above + 2 * width, above);
+		std::copy(below - width, below, below);
+	}
+}
+
+void IterateCellularAutomata(std::vector<bool>& grid, int rows, int columns, DrawMode& mode, Boundary boundary)
+{
+	if(rows <= 0 || columns <= 0)
+		return;
+
+	std::vector<uint8_t> padded;
+	PadCells(grid, rows, columns, boundary, padded);
+	const int width = columns + 2;
+
+	// Sand lands on the bottom whatever the boundary
+	if(mode == DrawMode::SAND)
+		std::fill(padded.end() - width, padded.end(), 1);
+
+	std::vector<bool> tmp = grid;
+	for(int i = 0; i < rows; i++)
+	{
+		const uint8_t* above = &padded[(size_t)i * width + 1];
+		const uint8_t* row = above + width;
+		const uint8_t* below = row + width;
+		for(int j = 0; j < columns; j++)
+		{
+			size_t index = (size_t)i * columns + j;
+
+			if(mode == DrawMode::GAME_OF_LIFE)
+			{
+				int numNeighbors = above[j - 1] + above[j] + above[j + 1] + row[j - 1] + row[j + 1] + below[j - 1] + below[j] + below[j + 1];
+				tmp[index] = numNeighbors == 3 || (row[j] && numNeighbors == 2);
+			}
+			else if(mode == DrawMode::SAND)
+			{
+				if(!row[j])
+					continue;
+
+				// Falling straight down, else to the left, else to the right
+				int l;
+				if(!below[j])
+					l = 0;
+				else if(!below[j - 1])
+					l = -1;
+				else if(!below[j + 1])
+					l = 1;
+				else
+					continue;
+
+				// Only TORUS and DEAD let a grain past the side, round to the
+				// other one or gone
+				int target = (j + l + columns) % columns;
+				if(boundary == Boundary::TORUS || target == j + l)
+					tmp[(size_t)(i + 1) * columns + target] = true;
+				tmp[index] = false;
+			}
+		}
+	}
+
+	grid = tmp;
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <vector>
+
+enum class DrawMode
+{
+	NONE,
+	NORMAL,
+	RAINBOW,
+	GAME_OF_LIFE,
+	SAND,
+	STROKE
+};
+
+// What lies past the edges of the grid
+enum class Boundary
+{
+	TORUS,	// The other side of the grid, left edge next to right and top next to bottom
+	DEAD,	// Nothing, dead cells all around
+	MIRROR	// The edge again, every cell just outside a copy of the one just inside
+};
+
+// Sand always lands on the bottom of the grid, only its sides follow the
+// boundary: grains go round to the other side with TORUS, fall off with DEAD
+// and pile up against MIRROR like against a wall
+void IterateCellularAutomata(std::vector<bool>& grid, int rows, int columns, DrawMode& mode, Boundary boundary);
@@ -0,0 +1,71 @@
+#include "CpuFeatures.hpp"
+#include <cstdint>
+
+#if CT_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+static void Cpuid(int leaf, int subleaf, uint32_t regs[4])
+{
+#ifdef _MSC_VER
+	int r[4];
+	__cpuidex(r, leaf, subleaf);
+	for(int i = 0; i < 4; i++)
+		regs[i] = (uint32_t)r[i];
+#else
+	__cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+// Which register states the OS saves on a context switch
+static uint64_t Xgetbv()
+{
+#ifdef _MSC_VER
+	return _xgetbv(0);
+#else
+	uint32_t eax, edx;
+	__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+	return ((uint64_t)edx << 32) | eax;
+#endif
+}
+
+static CpuFeatures Detect()
+{
+	CpuFeatures features;
+
+	uint32_t regs[4];
+	Cpuid(0, 0, regs);
+	uint32_t maxLeaf = regs[0];
+
+	Cpuid(1, 0, regs);
+	features.sse2 = (regs[3] & (1u << 26)) != 0;
+
+	bool osxsave = (regs[2] & (1u << 27)) != 0;
+	bool avx = (regs[2] & (1u << 28)) != 0;
+	if(!osxsave || !avx || maxLeaf < 7)
+		return features;
+
+	uint64_t xcr0 = Xgetbv();
+	bool ymmState = (xcr0 & 0x6) == 0x6;	// SSE and AVX registers
+	bool zmmState = (xcr0 & 0xe6) == 0xe6;	// ...and the AVX-512 ones
+
+	Cpuid(7, 0, regs);
+	features.avx2 = ymmState && (regs[1] & (1u << 5)) != 0;
+	features.avx512f = zmmState && (regs[1] & (1u << 16)) != 0;
+	return features;
+}
+#else
+static CpuFeatures Detect()
+{
+	return CpuFeatures();
+}
+#endif
+
+const CpuFeatures& GetCpuFeatures()
+{
+	static const CpuFeatures features = Detect();
+	return features;
+}
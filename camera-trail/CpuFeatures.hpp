@@ -0,0 +1,29 @@
+#pragma once
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define CT_X86 1
+#else
+#define CT_X86 0
+#endif
+
+// Lets a single function use instructions beyond what the file is compiled
+// for. MSVC allows any intrinsic anywhere, GCC and Clang need to be told.
+#if CT_X86 && (defined(__GNUC__) || defined(__clang__))
+#define CT_TARGET_SSE2 __attribute__((target("sse2")))
+#define CT_TARGET_AVX2 __attribute__((target("avx2")))
+#define CT_TARGET_AVX512 __attribute__((target("avx512f")))
+#else
+#define CT_TARGET_SSE2
+#define CT_TARGET_AVX2
+#define CT_TARGET_AVX512
+#endif
+
+struct CpuFeatures
+{
+	bool sse2 = false;
+	bool avx2 = false;
+	bool avx512f = false;
+};
+
+// What the CPU and the operating system both support, checked once
+const CpuFeatures& GetCpuFeatures();
@@ -0,0 +1,83 @@
+#include "EscapiSource.hpp"
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+#ifdef _WIN32
+#include <escapi.h>
+#endif
+
+EscapiSource::EscapiSource(unsigned device, int width, int height)
+	: device(device), width(width), height(height)
+{
+}
+
+EscapiSource::~EscapiSource()
+{
+#ifdef _WIN32
+	if(opened)
+	{
+		while(isCaptureDone(device) == 0) {} // Wait for last capture to end
+		deinitCapture(device);
+	}
+#endif
+	delete[] targetBuf;
+}
+
+bool EscapiSource::Open()
+{
+#ifdef _WIN32
+	// Initialize ESCAPI
+	int devices = setupESCAPI();
+	if(devices == 0)
+	{
+		printf("No camera detected!\n");
+		return false;
+	}
+
+	// ESCAPI keeps writing into this buffer, so it must live until deinitCapture
+	targetBuf = new int[width * height];
+
+	SimpleCapParams capture;
+	capture.mWidth = width;
+	capture.mHeight = height;
+	capture.mTargetBuf = targetBuf;
+	if(initCapture(device, &capture) == 0)
+	{
+		printf("Capture failed - the device may be already in use.\n");
+		return false;
+	}
+
+	opened = true;
+	start = std::chrono::steady_clock::now();
+	return true;
+#else
+	printf("ESCAPI camera capture is only available on Windows.\n");
+	return false;
+#endif
+}
+
+bool EscapiSource::NextFrame(Frame& frame, uint32_t* scratch)
+{
+#ifdef _WIN32
+	if(!opened)
+		return false;
+
+	doCapture(device);
+	while(isCaptureDone(device) == 0)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+	// The capture buffer is overwritten by the next request, so hand out a copy
+	memcpy(scratch, targetBuf, (size_t)width * height * sizeof(uint32_t));
+
+	frame.pixels = scratch;
+	frame.width = width;
+	frame.height = height;
+	frame.timestamp = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	return true;
+#else
+	(void)frame;
+	(void)scratch;
+	return false;
+#endif
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include "FrameSource.hpp"
+#include <chrono>
+
+// Frames from a webcam through ESCAPI (Windows only)
+class EscapiSource : public FrameSource
+{
+public:
+	EscapiSource(unsigned device, int width, int height);
+	~EscapiSource();
+
+	// Returns false if there is no camera or it is already in use
+	bool Open();
+
+	int Width() const override { return width; }
+	int Height() const override { return height; }
+	bool NextFrame(Frame& frame, uint32_t* scratch) override;
+
+private:
+	unsigned device;
+	int width;
+	int height;
+	bool opened = false;
+	int* targetBuf = nullptr;
+	std::chrono::steady_clock::time_point start;
+};
@@ -0,0 +1,101 @@
+#include "FrameCodec.hpp"
+#include <vector>
+
+const size_t MAX_LITERAL = 128;
+const size_t MIN_RUN = 3;
+const size_t MAX_RUN = 130;
+
+size_t MaxEncodedSize(size_t numPixels)
+{
+	size_t bytes = numPixels * 3;
+	return bytes + (bytes + MAX_LITERAL - 1) / MAX_LITERAL;
+}
+
+size_t EncodeDeltaRle(const uint32_t* frame, const uint32_t* previous, size_t numPixels, uint8_t* out)
+{
+	// Delta, three bytes per pixel
+	thread_local std::vector<uint8_t> delta;
+	delta.resize(numPixels * 3);
+	for(size_t i = 0; i < numPixels; i++)
+	{
+		uint32_t d = frame[i] ^ previous[i];
+		delta[i * 3 + 0] = (uint8_t)d;
+		delta[i * 3 + 1] = (uint8_t)(d >> 8);
+		delta[i * 3 + 2] = (uint8_t)(d >> 16);
+	}
+
+	const uint8_t* d = delta.data();
+	const size_t n = delta.size();
+	uint8_t* o = out;
+	size_t i = 0;
+	while(i < n)
+	{
+		// Run of the same byte
+		size_t run = 1;
+		while(i + run < n && run < MAX_RUN && d[i + run] == d[i])
+			run++;
+
+		if(run >= MIN_RUN)
+		{
+			*o++ = (uint8_t)(run + 125);
+			*o++ = d[i];
+			i += run;
+			continue;
+		}
+
+		// Literals, up to where the next run starts
+		size_t start = i;
+		while(i < n && i - start < MAX_LITERAL)
+		{
+			if(i + 2 < n && d[i] == d[i + 1] && d[i] == d[i + 2])
+				break;
+			i++;
+		}
+
+		*o++ = (uint8_t)(i - start - 1);
+		for(size_t k = start; k < i; k++)
+			*o++ = d[k];
+	}
+
+	return o - out;
+}
+
+bool DecodeDeltaRle(const uint8_t* in, size_t size, uint32_t* frame, size_t numPixels)
+{
+	const size_t n = numPixels * 3;
+	const uint8_t* end = in + size;
+	size_t p = 0;	// Position in the delta byte stream
+	while(in < end)
+	{
+		uint8_t control = *in++;
+		if(control < 128)
+		{
+			size_t count = (size_t)control + 1;
+			if(count > (size_t)(end - in) || p + count > n)
+				return false;
+
+			for(size_t k = 0; k < count; k++, p++)
+				frame[p / 3] ^= (uint32_t)in[k] << (8 * (p % 3));
+			in += count;
+		}
+		else
+		{
+			size_t count = (size_t)control - 125;
+			if(in == end || p + count > n)
+				return false;
+
+			uint8_t value = *in++;
+			if(value == 0)
+			{
+				// Unchanged pixels, nothing to apply
+				p += count;
+				continue;
+			}
+
+			for(size_t k = 0; k < count; k++, p++)
+				frame[p / 3] ^= (uint32_t)value << (8 * (p % 3));
+		}
+	}
+
+	return p == n;
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Recording codec. A frame is XORed against the previous one, which leaves zeros
+// wherever the scene did not change, and the R, G and B bytes of the result are
+// run-length encoded. Alpha is always 0xff in camera frames and is not stored.
+// The first frame of a session is encoded against opaque black (0xff000000).
+//
+// Run-length format, one control byte at a time:
+//   0..127   the next (control + 1) bytes are copied as they are
+//   128..255 the next byte repeats (control - 125) times
+
+// Worst case size of an encoded frame
+size_t MaxEncodedSize(size_t numPixels);
+
+// Encodes frame as a delta against previous. out must hold MaxEncodedSize bytes.
+// Returns the number of bytes written.
+size_t EncodeDeltaRle(const uint32_t* frame, const uint32_t* previous, size_t numPixels, uint8_t* out);
+
+// Turns the previous frame into the encoded one, in place.
+// Returns false if the data is malformed.
+bool DecodeDeltaRle(const uint8_t* in, size_t size, uint32_t* frame, size_t numPixels);
@@ -0,0 +1,62 @@
+#include "FrameProfiler.hpp"
+#include <algorithm>
+
+const char* FrameStageName(FrameStage stage)
+{
+	switch(stage)
+	{
+	case FrameStage::EVENTS: return "events";
+	case FrameStage::CAPTURE: return "capture";
+	case FrameStage::PIXELS: return "pixels";
+	case FrameStage::UPLOAD: return "upload";
+	case FrameStage::VERTICES: return "vertices";
+	case FrameStage::AUTOMATON: return "automaton";
+	case FrameStage::DRAW: return "draw";
+	case FrameStage::DISPLAY: return "display";
+	default: return "?";
+	}
+}
+
+void FrameProfiler::SetEnabled(bool enable)
+{
+	if(enable && !enabled)
+	{
+		// Start over, the old history has a gap in it
+		recorded = 0;
+		current = 0;
+		frameStart = std::chrono::steady_clock::now();
+		std::fill(&stages[0][0], &stages[0][0] + HISTORY * NUM_STAGES, 0.0);
+		std::fill(frames, frames + HISTORY, 0.0);
+	}
+	enabled = enable;
+}
+
+void FrameProfiler::NextFrame()
+{
+	if(!enabled)
+		return;
+
+	auto now = std::chrono::steady_clock::now();
+	frames[current] = std::chrono::duration<double, std::milli>(now - frameStart).count();
+	frameStart = now;
+
+	current = (current + 1) % HISTORY;
+	recorded = std::min(recorded + 1, HISTORY);
+	std::fill(stages[current], stages[current] + NUM_STAGES, 0.0);
+}
+
+double FrameProfiler::AverageStageTime(FrameStage stage) const
+{
+	double sum = 0.0;
+	for(int i = 0; i < recorded; i++)
+		sum += StageTime(i, stage);
+	return recorded ? sum / recorded : 0.0;
+}
+
+double FrameProfiler::AverageFrameTime() const
+{
+	double sum = 0.0;
+	for(int i = 0; i < recorded; i++)
+		sum += FrameTime(i);
+	return recorded ? sum / recorded : 0.0;
+}
@@ -0,0 +1,95 @@
+#pragma once
+#include "Trace.hpp"
+#include <chrono>
+
+enum class FrameStage
+{
+	EVENTS,
+	CAPTURE,
+	PIXELS,
+	UPLOAD,
+	VERTICES,
+	AUTOMATON,
+	DRAW,
+	DISPLAY,
+	COUNT
+};
+
+const char* FrameStageName(FrameStage stage);
+
+// Keeps the last HISTORY frames worth of per-stage timings. While disabled the
+// timers don't even read the clock, so leaving them in costs next to nothing.
+class FrameProfiler
+{
+public:
+	static const int HISTORY = 240;
+	static const int NUM_STAGES = (int)FrameStage::COUNT;
+
+	bool Enabled() const { return enabled; }
+	void SetEnabled(bool enable);
+
+	// Marks the start of a new frame, and the end of the previous one
+	void NextFrame();
+
+	void Add(FrameStage stage, double ms) { stages[current][(int)stage] += ms; }
+
+	// Timings of the frame that many frames ago; 0 is the last finished frame
+	double StageTime(int framesAgo, FrameStage stage) const { return stages[Index(framesAgo)][(int)stage]; }
+	double FrameTime(int framesAgo) const { return frames[Index(framesAgo)]; }
+
+	// Averages over the whole history
+	double AverageStageTime(FrameStage stage) const;
+	double AverageFrameTime() const;
+
+	int Recorded() const { return recorded; }
+
+private:
+	int Index(int framesAgo) const { return (current + HISTORY - 1 - framesAgo) % HISTORY; }
+
+	bool enabled = false;
+	double stages[HISTORY][NUM_STAGES] = {};
+	double frames[HISTORY] = {};
+	int current = 0;
+	int recorded = 0;
+	std::chrono::steady_clock::time_point frameStart;
+};
+
+// Adds the time until it goes out of scope to a stage of the current frame, and
+// to the trace when tracing
+class ScopedTimer
+{
+public:
+	ScopedTimer(FrameProfiler& profiler, FrameStage stage)
+		: profiler(profiler), stage(stage), profiling(profiler.Enabled()), tracing(TraceEnabled())
+	{
+		if(profiling || tracing)
+			start = std::chrono::steady_clock::now();
+	}
+
+	~ScopedTimer()
+	{
+		Stop();
+	}
+
+	// Ends the measurement before the end of the scope
+	void Stop()
+	{
+		if(profiling || tracing)
+		{
+			auto end = std::chrono::steady_clock::now();
+			if(profiling)
+				profiler.Add(stage, std::chrono::duration<double, std::milli>(end - start).count());
+			if(tracing)
+				TraceRecord(FrameStageName(stage), start, end);
+		}
+		profiling = false;
+		tracing = false;
+	}
+
+private:
+	FrameProfiler& profiler;
+	FrameStage stage;
+	bool profiling;
+	bool tracing;
+	std::chrono::steady_clock::time_point start;
+};
@@ -0,0 +1,40 @@
+#pragma once
+#include <cstdint>
+
+// A single captured camera frame. Pixels are laid out exactly like ESCAPI's
+// mTargetBuf: one 0xAARRGGBB int per pixel, row after row.
+struct Frame
+{
+	const uint32_t* pixels = nullptr;
+	int width = 0;
+	int height = 0;
+	uint64_t sequence = 0;	// Increases by one for every frame the source produced
+	double timestamp = 0.0;	// Seconds since the source was opened
+};
+
+// Anything that can produce camera frames: a real camera, a generator, a recording...
+class FrameSource
+{
+public:
+	virtual ~FrameSource() {}
+
+	virtual int Width() const = 0;
+	virtual int Height() const = 0;
+
+	// Blocks until the next frame is available. The source either writes the
+	// pixels into scratch (Width() * Height() ints) and points frame.pixels at
+	// it, or points frame.pixels at memory it owns for its whole lifetime.
+	// Fills in frame.timestamp; the caller numbers the frames.
+	// Returns false when the source has failed or ran out of frames.
+	virtual bool NextFrame(Frame& frame, uint32_t* scratch) = 0;
+};
+
+// Sees every captured frame, on the capture thread. The frame is only valid
+// for the duration of the call, and Submit must not block.
+class FrameSink
+{
+public:
+	virtual ~FrameSink() {}
+
+	virtual void Submit(const Frame& frame) = 0;
+};
@@ -0,0 +1,427 @@
+#include "HashLife.hpp"
+#include <algorithm>
+
+static const int MIN_ROOT_LEVEL = 5;
+static const size_t INITIAL_BUCKETS = 1 << 16;
+
+static uint64_t Mix(uint64_t h)
+{
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdull;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ull;
+	h ^= h >> 33;
+	return h;
+}
+
+// One generation of a row of up to 30 cells, bit x being column x. The
+// neighbours are added bit by bit into a count that sticks at 4 and over,
+// where a cell is dead whatever the rest of the count says.
+static uint32_t StepRow(uint32_t above, uint32_t row, uint32_t below)
+{
+	const uint32_t neighbours[8] = { above << 1, above, above >> 1, row << 1, row >> 1, below << 1, below, below >> 1 };
+	uint32_t ones = 0;
+	uint32_t twos = 0;
+	uint32_t fours = 0;
+	for(uint32_t n : neighbours)
+	{
+		uint32_t carry = ones & n;
+		ones ^= n;
+		fours |= twos & carry;
+		twos ^= carry;
+	}
+	return ~fours & twos & (ones | row);
+}
+
+// The 16 rows of 16 cells of four leaves put together
+static void JoinRows(uint64_t nw, uint64_t ne, uint64_t sw, uint64_t se, uint32_t rows[16])
+{
+	for(int y = 0; y < 8; y++)
+	{
+		rows[y] = (uint32_t)((nw >> (8 * y)) & 0xff) | (uint32_t)((ne >> (8 * y)) & 0xff) << 8;
+		rows[y + 8] = (uint32_t)((sw >> (8 * y)) & 0xff) | (uint32_t)((se >> (8 * y)) & 0xff) << 8;
+	}
+}
+
+static size_t HashKey(uint32_t nw, uint32_t ne, uint32_t sw, uint32_t se, uint64_t cells)
+{
+	return (size_t)(Mix(cells) ^ Mix(nw | (uint64_t)ne << 32) ^ Mix((sw | (uint64_t)se << 32) + 1));
+}
+
+HashLife::HashLife()
+{
+	Clear();
+}
+
+void HashLife::Clear()
+{
+	nodes.assign(1, Node());
+	freeNodes.clear();
+	buckets.assign(INITIAL_BUCKETS, 0);
+	emptyNodes.assign(64, 0);
+	held.clear();
+	collectAt = maxNodes;
+	root = Empty(MIN_ROOT_LEVEL);
+	generation = 0;
+}
+
+uint64_t HashLife::Population() const
+{
+	return nodes[root].population;
+}
+
+uint32_t HashLife::Intern(const Node& key)
+{
+	size_t hash = HashKey(key.nw, key.ne, key.sw, key.se, key.cells);
+	for(uint32_t i = buckets[hash & (buckets.size() - 1)]; i; i = nodes[i].next)
+	{
+		const Node& node = nodes[i];
+		if(node.nw == key.nw && node.ne == key.ne && node.sw == key.sw && node.se == key.se && node.cells == key.cells)
+			return i;
+	}
+
+	uint32_t index;
+	if(!freeNodes.empty())
+	{
+		index = freeNodes.back();
+		freeNodes.pop_back();
+		nodes[index] = key;
+	}
+	else
+	{
+		index = (uint32_t)nodes.size();
+		nodes.push_back(key);
+	}
+
+	size_t bucket = hash & (buckets.size() - 1);
+	nodes[index].next = buckets[bucket];
+	buckets[bucket] = index;
+
+	if(NumNodes() > buckets.size())
+		Rehash(buckets.size() * 2);
+	return index;
+}
+
+uint32_t HashLife::Leaf(uint64_t cells)
+{
+	Node key = Node();
+	key.cells = cells;
+	key.population = CountBits(cells);
+	key.level = LEAF_LEVEL;
+	return Intern(key);
+}
+
+uint32_t HashLife::Join(uint32_t nw, uint32_t ne, uint32_t sw, uint32_t se)
+{
+	Node key = Node();
+	key.nw = nw;
+	key.ne = ne;
+	key.sw = sw;
+	key.se = se;
+	key.population = nodes[nw].population + nodes[ne].population + nodes[sw].population + nodes[se].population;
+	key.level = (uint8_t)(nodes[nw].level + 1);
+	return Intern(key);
+}
+
+uint32_t HashLife::Empty(int level)
+{
+	if(!emptyNodes[level])
+	{
+		if(level == LEAF_LEVEL)
+			emptyNodes[level] = Leaf(0);
+		else
+		{
+			uint32_t quarter = Empty(level - 1);
+			emptyNodes[level] = Join(quarter, quarter, quarter, quarter);
+		}
+	}
+	return emptyNodes[level];
+}
+
+uint32_t HashLife::Expand(uint32_t node)
+{
+	const Node n = nodes[node];
+	uint32_t empty = Empty(n.level - 1);
+	uint32_t nw = Join(empty, empty, empty, n.nw);
+	uint32_t ne = Join(empty, empty, n.ne, empty);
+	uint32_t sw = Join(empty, n.sw, empty, empty);
+	uint32_t se = Join(n.se, empty, empty, empty);
+	return Join(nw, ne, sw, se);
+}
+
+uint32_t HashLife::Centre(uint32_t node)
+{
+	const Node n = nodes[node];
+	if(n.level == LEAF_LEVEL + 1)
+		return StepBase(node, 0);
+
+	return Join(nodes[n.nw].se, nodes[n.ne].sw, nodes[n.sw].ne, nodes[n.se].nw);
+}
+
+uint32_t HashLife::StepBase(uint32_t node, int generations)
+{
+	const Node n = nodes[node];
+	uint32_t rows[16];
+	JoinRows(nodes[n.nw].cells, nodes[n.ne].cells, nodes[n.sw].cells, nodes[n.se].cells, rows);
+
+	// Cells past the edge count as dead, which is only wrong a cell further
+	// in every generation, and the middle 8x8 is 4 cells in
+	for(int g = 0; g < generations; g++)
+	{
+		uint32_t above = 0;
+		for(int y = 0; y < 16; y++)
+		{
+			uint32_t row = rows[y];
+			rows[y] = StepRow(above, row, y < 15 ? rows[y + 1] : 0) & 0xffff;
+			above = row;
+		}
+	}
+
+	uint64_t cells = 0;
+	for(int y = 0; y < 8; y++)
+		cells |= (uint64_t)((rows[y + 4] >> 4) & 0xff) << (8 * y);
+	return Leaf(cells);
+}
+
+uint32_t HashLife::StepNode(uint32_t node, int log2Generations)
+{
+	if(nodes[node].population == 0)
+		return Empty(nodes[node].level - 1);
+
+	// Squares this size can only go so far at once, and all bigger steps are the same
+	int log = std::min(log2Generations, nodes[node].level - 2);
+	if(nodes[node].result && nodes[node].resultLog == log)
+		return nodes[node].result;
+
+	// Everything this step works out is held until it is done, so the
+	// squares can be collected in the middle of it
+	size_t firstHeld = held.size();
+	held.push_back(node);
+	if(NumNodes() > collectAt)
+		CollectGarbage();
+	const Node n = nodes[node];
+
+	uint32_t result;
+	if(n.level == LEAF_LEVEL + 1)
+		result = StepBase(node, 1 << log);
+	else
+	{
+		// Nine overlapping squares half the size, then four made of those
+		const Node a = nodes[n.nw];
+		const Node b = nodes[n.ne];
+		const Node c = nodes[n.sw];
+		const Node d = nodes[n.se];
+		uint32_t squares[9] =
+		{
+			n.nw, Join(a.ne, b.nw, a.se, b.sw), n.ne,
+			Join(a.sw, a.se, c.nw, c.ne), Join(a.se, b.sw, c.ne, d.nw), Join(b.sw, b.se, d.nw, d.ne),
+			n.sw, Join(c.ne, d.nw, c.se, d.sw), n.se
+		};
+
+		// A full step goes half the way with each, a shorter one all the way with the second
+		bool full = log == n.level - 2;
+		held.insert(held.end(), squares, squares + 9);
+		for(int i = 0; i < 9; i++)
+		{
+			squares[i] = full ? StepNode(squares[i], log) : Centre(squares[i]);
+			held.push_back(squares[i]);
+		}
+
+		uint32_t quarters[4];
+		const int corners[4] = { 0, 1, 3, 4 };	// Of the squares, the top left of the ones each quarter is made of
+		for(int i = 0; i < 4; i++)
+		{
+			const uint32_t* s = squares + corners[i];
+			quarters[i] = StepNode(Join(s[0], s[1], s[3], s[4]), log);
+			held.push_back(quarters[i]);
+		}
+		result = Join(quarters[0], quarters[1], quarters[2], quarters[3]);
+	}
+
+	held.resize(firstHeld);
+	nodes[node].result = result;
+	nodes[node].resultLog = (uint8_t)log;
+	return result;
+}
+
+void HashLife::Step(int log2Generations)
+{
+	log2Generations = std::min(std::max(log2Generations, 0), (int)MAX_STEP_LOG);
+
+	// Grow until the cells are all in the middle half and cannot get out of
+	// the universe in the time, then once more so the step's result, the
+	// middle half of that, is the universe as big as it was
+	for(;;)
+	{
+		const Node& n = nodes[root];
+		uint64_t middle = nodes[nodes[n.nw].se].population + nodes[nodes[n.ne].sw].population + nodes[nodes[n.sw].ne].population + nodes[nodes[n.se].nw].population;
+		if(n.level >= log2Generations + 2 && middle == n.population)
+			break;
+		root = Expand(root);
+	}
+
+	root = Expand(root);
+	root = StepNode(root, log2Generations);
+	generation += 1ull << log2Generations;
+}
+
+void HashLife::Write(const BitGrid& grid)
+{
+	while((1ll << (nodes[root].level - 1)) < std::max(grid.Rows(), grid.Columns()))
+		root = Expand(root);
+
+	int64_t half = 1ll << (nodes[root].level - 1);
+	root = WriteNode(root, -half, -half, grid);
+}
+
+uint32_t HashLife::WriteNode(uint32_t node, int64_t x, int64_t y, const BitGrid& grid)
+{
+	const Node n = nodes[node];
+	int64_t size = 1ll << n.level;
+	if(x >= grid.Columns() || y >= grid.Rows() || x + size <= 0 || y + size <= 0)
+		return node;
+
+	if(n.level == LEAF_LEVEL)
+	{
+		// Leaves are 8 cells wide on a multiple of 8, so never across a word
+		uint64_t mask = grid.Columns() - x >= 8 ? 0xff : (1ull << (grid.Columns() - x)) - 1;
+		uint64_t cells = n.cells;
+		for(int r = 0; r < 8; r++)
+		{
+			int64_t row = y + r;
+			if(row < 0 || row >= grid.Rows())
+				continue;
+
+			uint64_t bits = (grid.Row((int)row)[x / 64] >> (x % 64)) & mask;
+			cells = (cells & ~(mask << (8 * r))) | bits << (8 * r);
+		}
+		return cells == n.cells ? node : Leaf(cells);
+	}
+
+	// Squares the grid did not change stay the same node
+	int64_t half = size / 2;
+	uint32_t nw = WriteNode(n.nw, x, y, grid);
+	uint32_t ne = WriteNode(n.ne, x + half, y, grid);
+	uint32_t sw = WriteNode(n.sw, x, y + half, grid);
+	uint32_t se = WriteNode(n.se, x + half, y + half, grid);
+	if(nw == n.nw && ne == n.ne && sw == n.sw && se == n.se)
+		return node;
+	return Join(nw, ne, sw, se);
+}
+
+void HashLife::Read(BitGrid& grid) const
+{
+	std::fill(grid.Words(), grid.Words() + grid.NumWords(), 0);
+	int64_t half = 1ll << (nodes[root].level - 1);
+	ReadNode(root, -half, -half, grid);
+}
+
+void HashLife::ReadNode(uint32_t node, int64_t x, int64_t y, BitGrid& grid) const
+{
+	const Node& n = nodes[node];
+	int64_t size = 1ll << n.level;
+	if(n.population == 0 || x >= grid.Columns() || y >= grid.Rows() || x + size <= 0 || y + size <= 0)
+		return;
+
+	if(n.level == LEAF_LEVEL)
+	{
+		uint64_t mask = grid.Columns() - x >= 8 ? 0xff : (1ull << (grid.Columns() - x)) - 1;
+		for(int r = 0; r < 8; r++)
+		{
+			int64_t row = y + r;
+			if(row >= 0 && row < grid.Rows())
+				grid.Row((int)row)[x / 64] |= ((n.cells >> (8 * r)) & mask) << (x % 64);
+		}
+		return;
+	}
+
+	int64_t half = size / 2;
+	ReadNode(n.nw, x, y, grid);
+	ReadNode(n.ne, x + half, y, grid);
+	ReadNode(n.sw, x, y + half, grid);
+	ReadNode(n.se, x + half, y + half, grid);
+}
+
+void HashLife::Mark(uint32_t node)
+{
+	Node& n = nodes[node];
+	if(n.marked)
+		return;
+
+	n.marked = true;
+	if(n.level > LEAF_LEVEL)
+	{
+		Mark(n.nw);
+		Mark(n.ne);
+		Mark(n.sw);
+		Mark(n.se);
+	}
+}
+
+void HashLife::CollectGarbage()
+{
+	// If what the universe steps to does not fit in half, the universe alone
+	// has to do, and if that does not either it simply is that big
+	Collect(true);
+	if(NumNodes() > maxNodes / 2)
+		Collect(false);
+	collectAt = std::max(maxNodes, NumNodes() * 2);
+}
+
+void HashLife::Collect(bool keepResults)
+{
+	// The universe, the empty squares, what a step in progress holds on to,
+	// and what the universe's squares step to, which for anything periodic is
+	// most of the next universe
+	for(Node& n : nodes)
+		n.marked = false;
+	Mark(root);
+	for(uint32_t empty : emptyNodes)
+	{
+		if(empty)
+			Mark(empty);
+	}
+	for(uint32_t node : held)
+		Mark(node);
+
+	std::vector<uint32_t> results;
+	for(const Node& n : nodes)
+	{
+		if(keepResults && n.marked && n.result)
+			results.push_back(n.result);
+	}
+	for(uint32_t result : results)
+		Mark(result);
+
+	// Level 0 is a free node
+	for(uint32_t i = 1; i < (uint32_t)nodes.size(); i++)
+	{
+		if(nodes[i].level && !nodes[i].marked)
+		{
+			nodes[i].level = 0;
+			freeNodes.push_back(i);
+		}
+	}
+	for(Node& n : nodes)
+	{
+		if(n.result && !nodes[n.result].level)
+			n.result = 0;
+	}
+
+	Rehash(buckets.size());
+}
+
+void HashLife::Rehash(size_t numBuckets)
+{
+	buckets.assign(numBuckets, 0);
+	for(uint32_t i = 1; i < (uint32_t)nodes.size(); i++)
+	{
+		Node& n = nodes[i];
+		if(!n.level)
+			continue;
+
+		size_t bucket = HashKey(n.nw, n.ne, n.sw, n.se, n.cells) & (numBuckets - 1);
+		n.next = buckets[bucket];
+		buckets[bucket] = i;
+	}
+}
@@ -0,0 +1,111 @@
+#pragma once
+#include "BitGrid.hpp"
+#include <cstdint>
+#include <vector>
+
+// Game of Life on a universe far bigger than the screen, kept as a quadtree
+// in which every distinct square of cells exists only once, however often it
+// appears. What a square becomes is remembered with it, so a pattern that
+// repeats in space or in time is only worked out once, and stepping 2^k
+// generations at a time costs next to nothing more than stepping one once the
+// cells have settled into still lifes, oscillators and gliders.
+//
+// The universe grows as the cells spread. The screen's grid sits at (0, 0).
+class HashLife
+{
+public:
+	// Squares are collected once there are more than this
+	static const size_t DEFAULT_MAX_NODES = 1 << 21;
+
+	// A step can jump at most 2^MAX_STEP_LOG generations
+	static const int MAX_STEP_LOG = 30;
+
+	HashLife();
+
+	// Kills every cell and forgets every square
+	void Clear();
+
+	// Sets the cells under the grid to the grid's, everything around it stays
+	void Write(const BitGrid& grid);
+
+	// Copies the cells under the grid into it
+	void Read(BitGrid& grid) const;
+
+	// Moves the whole universe on 2^log2Generations generations
+	void Step(int log2Generations);
+
+	uint64_t Generation() const { return generation; }
+	uint64_t Population() const;
+
+	// Squares in memory, the current universe, what was remembered about
+	// earlier ones and whatever was not collected yet
+	size_t NumNodes() const { return nodes.size() - 1 - freeNodes.size(); }
+
+	// Once there are more squares than this, every square that is not part of
+	// the universe or of the step being worked out is dropped, and so is
+	// everything remembered about stepping them. If the universe is bigger than
+	// that by itself, it is let grow to twice its size before the next try.
+	void SetMaxNodes(size_t maxNodes) { this->maxNodes = collectAt = maxNodes; }
+
+private:
+	// 8x8 cells, row y in byte y, column x in bit x of it
+	static const int LEAF_LEVEL = 3;
+
+	// A square of 2^level x 2^level cells. Leaves hold their cells, the others
+	// their four quarters. Index 0 is no node.
+	struct Node
+	{
+		uint32_t nw;
+		uint32_t ne;
+		uint32_t sw;
+		uint32_t se;
+		uint64_t cells;	// Leaves only
+		uint64_t population;
+		uint32_t next;	// In the same hash bucket
+		uint32_t result;	// The centre quarter stepped resultLog, 0 if not worked out yet
+		uint8_t level;
+		uint8_t resultLog;
+		bool marked;
+	};
+
+	uint32_t Leaf(uint64_t cells);
+	uint32_t Join(uint32_t nw, uint32_t ne, uint32_t sw, uint32_t se);
+	uint32_t Empty(int level);
+
+	// The node that already has these cells or quarters, or a new one
+	uint32_t Intern(const Node& key);
+
+	// The same square in the middle of one twice the size
+	uint32_t Expand(uint32_t node);
+
+	// The middle half of a square, without stepping it
+	uint32_t Centre(uint32_t node);
+
+	// The middle half of a square, 2^min(log2Generations, level - 2) generations on
+	uint32_t StepNode(uint32_t node, int log2Generations);
+
+	// The middle 8x8 of a 16x16 square, up to 4 generations on, also its
+	// Centre() with none
+	uint32_t StepBase(uint32_t node, int generations);
+
+	uint32_t WriteNode(uint32_t node, int64_t x, int64_t y, const BitGrid& grid);
+	void ReadNode(uint32_t node, int64_t x, int64_t y, BitGrid& grid) const;
+
+	// Frees every node that is not part of the universe, or of what its
+	// squares were stepped to with keepResults
+	void Mark(uint32_t node);
+	void Collect(bool keepResults);
+	void CollectGarbage();
+	void Rehash(size_t numBuckets);
+
+	std::vector<Node> nodes;
+	std::vector<uint32_t> freeNodes;
+	std::vector<uint32_t> buckets;
+	std::vector<uint32_t> emptyNodes;	// By level, 0 until needed
+	size_t maxNodes = DEFAULT_MAX_NODES;
+	size_t collectAt = DEFAULT_MAX_NODES;
+	std::vector<uint32_t> held;	// By the steps in progress
+
+	uint32_t root;	// Centred on (0, 0), never smaller than 32x32
+	uint64_t generation = 0;
+};
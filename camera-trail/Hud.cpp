@@ -0,0 +1,116 @@
+#include "Hud.hpp"
+#include <algorithm>
+#include <cstdio>
+
+static const int ROW_HEIGHT = 24;
+static const float ROW_MS = 5.0f;	// Stage time that fills a whole row
+static const int HISTOGRAM_BINS = 34;	// 1 ms each, the last one takes everything slower
+static const int HISTOGRAM_HEIGHT = 60;
+static const int MARGIN = 8;
+
+static const sf::Color STAGE_COLORS[FrameProfiler::NUM_STAGES] =
+{
+	sf::Color(120, 120, 255),	// events
+	sf::Color(0, 200, 255),	// capture
+	sf::Color(255, 80, 80),	// pixels
+	sf::Color(255, 165, 0),	// upload
+	sf::Color(255, 255, 0),	// vertices
+	sf::Color(0, 255, 100),	// automaton
+	sf::Color(200, 0, 255),	// draw
+	sf::Color(200, 200, 200)	// display
+};
+
+static void AddRect(sf::VertexArray& vertices, float x, float y, float w, float h, sf::Color color)
+{
+	vertices.append(sf::Vertex(sf::Vector2f(x, y), color));
+	vertices.append(sf::Vertex(sf::Vector2f(x + w, y), color));
+	vertices.append(sf::Vertex(sf::Vector2f(x + w, y + h), color));
+	vertices.append(sf::Vertex(sf::Vector2f(x, y + h), color));
+}
+
+Hud::Hud(sf::RenderWindow& window, const char* title)
+	: window(window), title(title), vertices(sf::Quads)
+{
+}
+
+void Hud::Toggle(FrameProfiler& profiler)
+{
+	visible = !visible;
+	profiler.SetEnabled(visible);
+	framesUntilTitle = 0;
+
+	if(!visible)
+		window.setTitle(title);
+}
+
+void Hud::Draw(const FrameProfiler& profiler)
+{
+	if(!visible)
+		return;
+
+	const int numStages = FrameProfiler::NUM_STAGES;
+	const float graphWidth = (float)FrameProfiler::HISTORY;
+	const float panelWidth = graphWidth + 3 * MARGIN + ROW_HEIGHT / 2;
+	const float panelHeight = numStages * ROW_HEIGHT + HISTOGRAM_HEIGHT + 3 * MARGIN;
+	const float left = (float)MARGIN;
+	const float top = window.getSize().y - panelHeight - MARGIN;
+
+	vertices.clear();
+	AddRect(vertices, left, top, panelWidth, panelHeight, sf::Color(0, 0, 0, 180));
+
+	// One row per stage: a color key, then the newest frame on the right
+	float x0 = left + 2 * MARGIN + ROW_HEIGHT / 2;
+	for(int s = 0; s < numStages; s++)
+	{
+		float rowBottom = top + MARGIN + (s + 1) * ROW_HEIGHT;
+		AddRect(vertices, left + MARGIN, rowBottom - ROW_HEIGHT / 2 - 2, ROW_HEIGHT / 2 - 4.0f, ROW_HEIGHT / 2 - 4.0f, STAGE_COLORS[s]);
+
+		for(int i = 0; i < profiler.Recorded(); i++)
+		{
+			float ms = (float)profiler.StageTime(i, (FrameStage)s);
+			float h = std::min(ms / ROW_MS, 1.0f) * (ROW_HEIGHT - 2);
+			if(h > 0.0f)
+				AddRect(vertices, x0 + graphWidth - 1 - i, rowBottom - h, 1.0f, h, STAGE_COLORS[s]);
+		}
+	}
+
+	// Frame time histogram, with a marker at the 60 fps budget
+	int bins[HISTOGRAM_BINS] = {};
+	int maxCount = 1;
+	for(int i = 0; i < profiler.Recorded(); i++)
+	{
+		int bin = std::min((int)profiler.FrameTime(i), HISTOGRAM_BINS - 1);
+		maxCount = std::max(maxCount, ++bins[bin]);
+	}
+
+	float histogramBottom = top + panelHeight - MARGIN;
+	float binWidth = graphWidth / HISTOGRAM_BINS;
+	for(int b = 0; b < HISTOGRAM_BINS; b++)
+	{
+		float h = (float)bins[b] / maxCount * HISTOGRAM_HEIGHT;
+		sf::Color color = b < 16 ? sf::Color(0, 255, 100) : (b < 33 ? sf::Color(255, 165, 0) : sf::Color(255, 80, 80));
+		AddRect(vertices, x0 + b * binWidth, histogramBottom - h, binWidth - 1, h, color);
+	}
+	AddRect(vertices, x0 + 16.6f * binWidth, histogramBottom - HISTOGRAM_HEIGHT, 1.0f, (float)HISTOGRAM_HEIGHT, sf::Color::White);
+
+	window.draw(vertices);
+	UpdateTitle(profiler);
+}
+
+void Hud::UpdateTitle(const FrameProfiler& profiler)
+{
+	// Changing the title is not free, twice a second is plenty
+	if(framesUntilTitle-- > 0)
+		return;
+	framesUntilTitle = 30;
+
+	char text[512];
+	double frameTime = profiler.AverageFrameTime();
+	int n = snprintf(text, sizeof(text), "%s | %.2f ms (%.0f fps) |", title, frameTime, frameTime > 0.0 ? 1000.0 / frameTime : 0.0);
+	for(int s = 0; s < FrameProfiler::NUM_STAGES && n < (int)sizeof(text); s++)
+		n += snprintf(text + n, sizeof(text) - n, " %s %.2f", FrameStageName((FrameStage)s), profiler.AverageStageTime((FrameStage)s));
+	if(!status.empty() && n < (int)sizeof(text))
+		snprintf(text + n, sizeof(text) - n, " | %s", status.c_str());
+
+	window.setTitle(text);
+}
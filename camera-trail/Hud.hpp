@@ -0,0 +1,31 @@
+#pragma once
+#include "FrameProfiler.hpp"
+#include <SFML/Graphics.hpp>
+#include <string>
+
+// Overlay with a rolling bar graph per frame stage and a histogram of frame
+// times. There is no font to draw text with, so the numbers go into the title
+// bar of the window instead.
+class Hud
+{
+public:
+	Hud(sf::RenderWindow& window, const char* title);
+
+	bool Visible() const { return visible; }
+	void Toggle(FrameProfiler& profiler);
+
+	void Draw(const FrameProfiler& profiler);
+
+	// Shown after the stage times, for whatever else is worth watching
+	void SetStatus(const std::string& text) { status = text; }
+
+private:
+	void UpdateTitle(const FrameProfiler& profiler);
+
+	sf::RenderWindow& window;
+	const char* title;
+	std::string status;
+	sf::VertexArray vertices;
+	bool visible = false;
+	int framesUntilTitle = 0;
+};
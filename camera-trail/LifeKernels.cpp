@@ -0,0 +1,279 @@
+#include "LifeKernels.hpp"
+#include "CpuFeatures.hpp"
+#include <cstdio>
+#include <vector>
+
+#if CT_X86
+#include <immintrin.h>
+#endif
+
+// Every cell's left and right neighbour, at the cell's own bit
+static inline uint64_t Left(const uint64_t* x, int w)
+{
+	return (x[w] << 1) | (x[w - 1] >> 63);
+}
+
+static inline uint64_t Right(const uint64_t* x, int w)
+{
+	return (x[w] >> 1) | (x[w + 1] << 63);
+}
+
+static void StepRowScalar(const uint64_t* above, const uint64_t* row, const uint64_t* below, uint64_t* next, int words)
+{
+	for(int w = 0; w < words; w++)
+	{
+		// Each row above and below adds up to 3, as two bits
+		uint64_t a = above[w];
+		uint64_t aLeft = Left(above, w);
+		uint64_t aRight = Right(above, w);
+		uint64_t aOnes = aLeft ^ a ^ aRight;
+		uint64_t aTwos = (aLeft & a) | (aRight & (aLeft ^ a));
+
+		uint64_t b = below[w];
+		uint64_t bLeft = Left(below, w);
+		uint64_t bRight = Right(below, w);
+		uint64_t bOnes = bLeft ^ b ^ bRight;
+		uint64_t bTwos = (bLeft & b) | (bRight & (bLeft ^ b));
+
+		// The cell's own row only adds its two sides
+		uint64_t mLeft = Left(row, w);
+		uint64_t mRight = Right(row, w);
+		uint64_t mOnes = mLeft ^ mRight;
+		uint64_t mTwos = mLeft & mRight;
+
+		// The count modulo 8, an 8 looks like a 0 which is just as dead
+		uint64_t ones = aOnes ^ bOnes ^ mOnes;
+		uint64_t carry = (aOnes & bOnes) | (mOnes & (aOnes ^ bOnes));
+		uint64_t twosSum = aTwos ^ bTwos ^ mTwos;
+		uint64_t twosCarry = (aTwos & bTwos) | (mTwos & (aTwos ^ bTwos));
+		uint64_t twos = twosSum ^ carry;
+		uint64_t fours = twosCarry ^ (twosSum & carry);
+
+		// Born with 3, survives with 2 or 3
+		next[w] = twos & ~fours & (ones | row[w]);
+	}
+}
+
+#if CT_X86
+// Left and Right for 4 words at once, the unaligned loads one word back and
+// one word on bring every lane the word next to it
+CT_TARGET_AVX2
+static inline __m256i LeftAvx2(const uint64_t* x, int w)
+{
+	__m256i v = _mm256_loadu_si256((const __m256i*)(x + w));
+	__m256i before = _mm256_loadu_si256((const __m256i*)(x + w - 1));
+	return _mm256_or_si256(_mm256_slli_epi64(v, 1), _mm256_srli_epi64(before, 63));
+}
+
+CT_TARGET_AVX2
+static inline __m256i RightAvx2(const uint64_t* x, int w)
+{
+	__m256i v = _mm256_loadu_si256((const __m256i*)(x + w));
+	__m256i after = _mm256_loadu_si256((const __m256i*)(x + w + 1));
+	return _mm256_or_si256(_mm256_srli_epi64(v, 1), _mm256_slli_epi64(after, 63));
+}
+
+CT_TARGET_AVX2
+static void StepRowAvx2(const uint64_t* above, const uint64_t* row, const uint64_t* below, uint64_t* next, int words)
+{
+	int w = 0;
+	for(; w + 4 <= words; w += 4)
+	{
+		__m256i a = _mm256_loadu_si256((const __m256i*)(above + w));
+		__m256i aLeft = LeftAvx2(above, w);
+		__m256i aRight = RightAvx2(above, w);
+		__m256i aSides = _mm256_xor_si256(aLeft, a);
+		__m256i aOnes = _mm256_xor_si256(aSides, aRight);
+		__m256i aTwos = _mm256_or_si256(_mm256_and_si256(aLeft, a), _mm256_and_si256(aRight, aSides));
+
+		__m256i b = _mm256_loadu_si256((const __m256i*)(below + w));
+		__m256i bLeft = LeftAvx2(below, w);
+		__m256i bRight = RightAvx2(below, w);
+		__m256i bSides = _mm256_xor_si256(bLeft, b);
+		__m256i bOnes = _mm256_xor_si256(bSides, bRight);
+		__m256i bTwos = _mm256_or_si256(_mm256_and_si256(bLeft, b), _mm256_and_si256(bRight, bSides));
+
+		__m256i mLeft = LeftAvx2(row, w);
+		__m256i mRight = RightAvx2(row, w);
+		__m256i mOnes = _mm256_xor_si256(mLeft, mRight);
+		__m256i mTwos = _mm256_and_si256(mLeft, mRight);
+
+		__m256i abOnes = _mm256_xor_si256(aOnes, bOnes);
+		__m256i ones = _mm256_xor_si256(abOnes, mOnes);
+		__m256i carry = _mm256_or_si256(_mm256_and_si256(aOnes, bOnes), _mm256_and_si256(mOnes, abOnes));
+		__m256i abTwos = _mm256_xor_si256(aTwos, bTwos);
+		__m256i twosSum = _mm256_xor_si256(abTwos, mTwos);
+		__m256i twosCarry = _mm256_or_si256(_mm256_and_si256(aTwos, bTwos), _mm256_and_si256(mTwos, abTwos));
+		__m256i twos = _mm256_xor_si256(twosSum, carry);
+		__m256i fours = _mm256_xor_si256(twosCarry, _mm256_and_si256(twosSum, carry));
+
+		__m256i alive = _mm256_loadu_si256((const __m256i*)(row + w));
+		__m256i result = _mm256_andnot_si256(fours, _mm256_and_si256(twos, _mm256_or_si256(ones, alive)));
+		_mm256_storeu_si256((__m256i*)(next + w), result);
+	}
+
+	if(w < words)
+		StepRowScalar(above + w, row + w, below + w, next + w, words - w);
+}
+
+// Every lane kept, which is the plain shift. GCC 12 warns about the undefined
+// vector the unmasked intrinsics pass in for the lanes nothing is written to.
+static const __mmask8 ALL_LANES = 0xff;
+
+CT_TARGET_AVX512
+static inline __m512i LeftAvx512(const uint64_t* x, int w)
+{
+	__m512i v = _mm512_loadu_si512((const void*)(x + w));
+	__m512i before = _mm512_loadu_si512((const void*)(x + w - 1));
+	return _mm512_or_si512(_mm512_maskz_slli_epi64(ALL_LANES, v, 1), _mm512_maskz_srli_epi64(ALL_LANES, before, 63));
+}
+
+CT_TARGET_AVX512
+static inline __m512i RightAvx512(const uint64_t* x, int w)
+{
+	__m512i v = _mm512_loadu_si512((const void*)(x + w));
+	__m512i after = _mm512_loadu_si512((const void*)(x + w + 1));
+	return _mm512_or_si512(_mm512_maskz_srli_epi64(ALL_LANES, v, 1), _mm512_maskz_slli_epi64(ALL_LANES, after, 63));
+}
+
+// vpternlog truth tables, with the operands as 0xf0, 0xcc and 0xaa
+static const int XOR3 = 0x96;
+static const int MAJORITY = 0xe8;
+static const int A_XOR_B_AND_C = 0x78;
+static const int A_AND_NOT_B_AND_C = 0x20;
+
+CT_TARGET_AVX512
+static void StepRowAvx512(const uint64_t* above, const uint64_t* row, const uint64_t* below, uint64_t* next, int words)
+{
+	int w = 0;
+	for(; w + 8 <= words; w += 8)
+	{
+		// A full adder is two instructions
+		__m512i a = _mm512_loadu_si512((const void*)(above + w));
+		__m512i aLeft = LeftAvx512(above, w);
+		__m512i aRight = RightAvx512(above, w);
+		__m512i aOnes = _mm512_ternarylogic_epi64(aLeft, a, aRight, XOR3);
+		__m512i aTwos = _mm512_ternarylogic_epi64(aLeft, a, aRight, MAJORITY);
+
+		__m512i b = _mm512_loadu_si512((const void*)(below + w));
+		__m512i bLeft = LeftAvx512(below, w);
+		__m512i bRight = RightAvx512(below, w);
+		__m512i bOnes = _mm512_ternarylogic_epi64(bLeft, b, bRight, XOR3);
+		__m512i bTwos = _mm512_ternarylogic_epi64(bLeft, b, bRight, MAJORITY);
+
+		__m512i mLeft = LeftAvx512(row, w);
+		__m512i mRight = RightAvx512(row, w);
+		__m512i mOnes = _mm512_xor_si512(mLeft, mRight);
+		__m512i mTwos = _mm512_and_si512(mLeft, mRight);
+
+		__m512i ones = _mm512_ternarylogic_epi64(aOnes, bOnes, mOnes, XOR3);
+		__m512i carry = _mm512_ternarylogic_epi64(aOnes, bOnes, mOnes, MAJORITY);
+		__m512i twosSum = _mm512_ternarylogic_epi64(aTwos, bTwos, mTwos, XOR3);
+		__m512i twosCarry = _mm512_ternarylogic_epi64(aTwos, bTwos, mTwos, MAJORITY);
+		__m512i twos = _mm512_xor_si512(twosSum, carry);
+		__m512i fours = _mm512_ternarylogic_epi64(twosCarry, twosSum, carry, A_XOR_B_AND_C);
+
+		__m512i alive = _mm512_loadu_si512((const void*)(row + w));
+		__m512i result = _mm512_ternarylogic_epi64(twos, fours, _mm512_or_si512(ones, alive), A_AND_NOT_B_AND_C);
+		_mm512_storeu_si512((void*)(next + w), result);
+	}
+
+	if(w < words)
+		StepRowAvx2(above + w, row + w, below + w, next + w, words - w);
+}
+#endif
+
+const char* LifeIsaName(LifeIsa isa)
+{
+	switch(isa)
+	{
+	case LifeIsa::SCALAR: return "scalar";
+	case LifeIsa::AVX2: return "avx2";
+	case LifeIsa::AVX512: return "avx512";
+	}
+	return "?";
+}
+
+bool LifeIsaSupported(LifeIsa isa)
+{
+	const CpuFeatures& cpu = GetCpuFeatures();
+	switch(isa)
+	{
+	case LifeIsa::SCALAR: return true;
+	case LifeIsa::AVX2: return CT_X86 && cpu.avx2;
+	case LifeIsa::AVX512: return CT_X86 && cpu.avx512f && cpu.avx2;
+	}
+	return false;
+}
+
+LifeIsa BestLifeIsa()
+{
+	if(LifeIsaSupported(LifeIsa::AVX512))
+		return LifeIsa::AVX512;
+	if(LifeIsaSupported(LifeIsa::AVX2))
+		return LifeIsa::AVX2;
+	return LifeIsa::SCALAR;
+}
+
+LifeRowKernel GetLifeRowKernel(LifeIsa isa)
+{
+#if CT_X86
+	if(isa == LifeIsa::AVX512 && LifeIsaSupported(isa))
+		return StepRowAvx512;
+	if(isa == LifeIsa::AVX2 && LifeIsaSupported(isa))
+		return StepRowAvx2;
+#endif
+	return StepRowScalar;
+}
+
+bool LifeKernelSelfTest()
+{
+	// xorshift32, so every run tests the same rows
+	uint32_t state = 12345;
+	auto random = [&state]()
+	{
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return state;
+	};
+
+	const LifeIsa isas[] = { LifeIsa::AVX2, LifeIsa::AVX512 };
+	const int widths[] = { 1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 33 };
+
+	for(int words : widths)
+	for(int round = 0; round < 8; round++)
+	{
+		// Three rows with their halo and spare words, denser every round
+		std::vector<uint64_t> rows[3];
+		for(std::vector<uint64_t>& row : rows)
+		{
+			row.resize(words + 2);
+			for(uint64_t& word : row)
+			{
+				word = ((uint64_t)random() << 32) | random();
+				for(int k = 0; k < round % 4; k++)
+					word &= ((uint64_t)random() << 32) | random();
+			}
+		}
+
+		std::vector<uint64_t> expected(words);
+		StepRowScalar(rows[0].data() + 1, rows[1].data() + 1, rows[2].data() + 1, expected.data(), words);
+
+		for(LifeIsa isa : isas)
+		{
+			if(!LifeIsaSupported(isa))
+				continue;
+
+			std::vector<uint64_t> actual(words);
+			GetLifeRowKernel(isa)(rows[0].data() + 1, rows[1].data() + 1, rows[2].data() + 1, actual.data(), words);
+			if(actual != expected)
+			{
+				printf("Life kernel %s differs from scalar (%d words)\n", LifeIsaName(isa), words);
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <cstdint>
+
+// One generation of Game of Life for a row of a BitGrid, 64 cells per word.
+// The eight neighbours of every cell are added with bitwise full adders, one
+// bit of the count per word, so every cell of a word is done at once. The
+// vector kernels do the same on 4 or 8 words at a time.
+
+enum class LifeIsa
+{
+	SCALAR,
+	AVX2,
+	AVX512	// AVX-512F, with vpternlog doing a whole full adder per instruction
+};
+
+// above, row and below point at the first word of cells and have a halo word
+// before it and a spare word after the last one. Writes words words into next.
+typedef void (*LifeRowKernel)(const uint64_t* above, const uint64_t* row, const uint64_t* below, uint64_t* next, int words);
+
+const char* LifeIsaName(LifeIsa isa);
+bool LifeIsaSupported(LifeIsa isa);
+
+// The fastest one this CPU supports
+LifeIsa BestLifeIsa();
+
+LifeRowKernel GetLifeRowKernel(LifeIsa isa);
+
+// Steps random rows with every supported kernel and checks they all produce
+// exactly what the scalar one does. Prints the first mismatch.
+bool LifeKernelSelfTest();
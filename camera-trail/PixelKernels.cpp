@@ -0,0 +1,458 @@
+#include "PixelKernels.hpp"
+#include "CpuFeatures.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#if CT_X86
+#include <immintrin.h>
+#endif
+
+static int ProcessRowScalar(const uint32_t* src, uint16_t* stamps, uint8_t* dst, int width, const PixelKernelOptions& options, int* litColumns)
+{
+	int numLit = 0;
+	for(int j = 0; j < width; j++)
+	{
+		uint32_t p = src[j];
+		uint8_t r = (uint8_t)(p >> 16);
+		uint8_t g = (uint8_t)(p >> 8);
+		uint8_t b = (uint8_t)p;
+		uint16_t stamp = stamps[j];
+
+		if(options.draw && r >= options.threshold && g >= options.threshold && b >= options.threshold)
+		{
+			stamp = options.punch ? options.now : (uint16_t)(stamp + options.elapsed);
+			stamps[j] = stamp;
+			litColumns[numLit++] = j;
+		}
+
+		if(!dst)
+			continue;
+
+		uint16_t age = (uint16_t)(options.now - stamp);
+		if(age > options.maxAge)
+			age = options.maxAge;
+
+		dst[j * 4 + 0] = r;
+		dst[j * 4 + 1] = g;
+		dst[j * 4 + 2] = b;
+		dst[j * 4 + 3] = (uint8_t)(options.fadeTable[age] >> 24);
+	}
+	return numLit;
+}
+
+static void TileMaxScalar(const uint32_t* src, int stride, int width, int height, uint8_t* tileMax)
+{
+	for(int first = 0; first < width; first += BRIGHT_TILE_SIZE)
+	{
+		int end = std::min(first + BRIGHT_TILE_SIZE, width);
+		uint32_t brightest = 0;
+		for(int i = 0; i < height; i++)
+		{
+			const uint32_t* row = src + (size_t)i * stride;
+			for(int j = first; j < end; j++)
+			{
+				uint32_t p = row[j];
+				uint32_t darkest = std::min(std::min(p & 0xff, (p >> 8) & 0xff), (p >> 16) & 0xff);
+				brightest = std::max(brightest, darkest);
+			}
+		}
+		tileMax[first / BRIGHT_TILE_SIZE] = (uint8_t)brightest;
+	}
+}
+
+// Tiles the vector kernels keep a running maximum for at once, row after row
+static const int TILE_MAX_CHUNK = 256;
+
+#if CT_X86
+CT_TARGET_SSE2
+static void TileMaxSse2(const uint32_t* src, int stride, int width, int height, uint8_t* tileMax)
+{
+	// Only the low byte of every pixel is kept: min(B, G, R) once G and R are shifted onto it
+	const int numTiles = width / BRIGHT_TILE_SIZE;
+	for(int first = 0; first < numTiles; first += TILE_MAX_CHUNK)
+	{
+		int count = std::min(numTiles - first, TILE_MAX_CHUNK);
+		__m128i maxima[TILE_MAX_CHUNK];
+		for(int t = 0; t < count; t++)
+			maxima[t] = _mm_setzero_si128();
+
+		for(int i = 0; i < height; i++)
+		{
+			const uint32_t* p = src + (size_t)i * stride + first * BRIGHT_TILE_SIZE;
+			for(int t = 0; t < count; t++, p += BRIGHT_TILE_SIZE)
+			{
+				for(int v = 0; v < BRIGHT_TILE_SIZE; v += 4)
+				{
+					__m128i pixels = _mm_loadu_si128((const __m128i*)(p + v));
+					__m128i darkest = _mm_min_epu8(pixels, _mm_min_epu8(_mm_srli_epi32(pixels, 8), _mm_srli_epi32(pixels, 16)));
+					maxima[t] = _mm_max_epu8(maxima[t], darkest);
+				}
+			}
+		}
+
+		const __m128i byte = _mm_set1_epi32(0xff);
+		for(int t = 0; t < count; t++)
+		{
+			__m128i m = _mm_and_si128(maxima[t], byte);
+			m = _mm_max_epu8(m, _mm_srli_si128(m, 8));
+			m = _mm_max_epu8(m, _mm_srli_si128(m, 4));
+			tileMax[first + t] = (uint8_t)_mm_cvtsi128_si32(m);
+		}
+	}
+
+	if(numTiles * BRIGHT_TILE_SIZE < width)
+		TileMaxScalar(src + numTiles * BRIGHT_TILE_SIZE, stride, width - numTiles * BRIGHT_TILE_SIZE, height, tileMax + numTiles);
+}
+
+CT_TARGET_SSE2
+static int ProcessRowSse2(const uint32_t* src, uint16_t* stamps, uint8_t* dst, int width, const PixelKernelOptions& options, int* litColumns)
+{
+	const __m128i threshold = _mm_set1_epi8((char)options.threshold);
+	const __m128i rgbMask = _mm_set1_epi32(0x00ffffff);
+	const __m128i draw = options.draw ? _mm_set1_epi32(-1) : _mm_setzero_si128();
+	const __m128i byte = _mm_set1_epi32(0xff);
+	const __m128i green = _mm_set1_epi32(0xff00);
+	const __m128i low16 = _mm_set1_epi32(0xffff);
+	const __m128i now = _mm_set1_epi32(options.now);
+	const __m128i elapsed = _mm_set1_epi32(options.elapsed);
+	const __m128i maxAge = _mm_set1_epi32(options.maxAge);
+	const uint32_t* fadeTable = options.fadeTable;
+
+	int numLit = 0;
+	int j = 0;
+	for(; j + 4 <= width; j += 4)
+	{
+		__m128i p = _mm_loadu_si128((const __m128i*)(src + j));
+
+		// BGRX ints to RGBA bytes: swap the red and blue bytes
+		__m128i rgb = _mm_or_si128(_mm_or_si128(
+			_mm_and_si128(_mm_srli_epi32(p, 16), byte),
+			_mm_and_si128(p, green)),
+			_mm_slli_epi32(_mm_and_si128(p, byte), 16));
+
+		// A byte is >= threshold when max(byte, threshold) == byte
+		__m128i ge = _mm_cmpeq_epi8(_mm_max_epu8(p, threshold), p);
+		__m128i lit = _mm_and_si128(_mm_cmpeq_epi32(_mm_and_si128(ge, rgbMask), rgbMask), draw);
+		int bits = _mm_movemask_ps(_mm_castsi128_ps(lit));
+
+		// Looking for light only needs the stamps of lit pixels
+		if(!bits && !dst)
+			continue;
+
+		__m128i stamp = _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i*)(stamps + j)), _mm_setzero_si128());
+		if(bits)
+		{
+			__m128i litStamp = options.punch ? now : _mm_and_si128(_mm_add_epi32(stamp, elapsed), low16);
+			stamp = _mm_or_si128(_mm_and_si128(lit, litStamp), _mm_andnot_si128(lit, stamp));
+
+			// Sign extend so the saturating pack keeps all 16 bits
+			__m128i packed = _mm_srai_epi32(_mm_slli_epi32(stamp, 16), 16);
+			_mm_storel_epi64((__m128i*)(stamps + j), _mm_packs_epi32(packed, packed));
+		}
+
+		if(dst)
+		{
+			// Ages fit in 16 bits, so the signed compare is safe
+			__m128i age = _mm_and_si128(_mm_sub_epi32(now, stamp), low16);
+			__m128i old = _mm_cmpgt_epi32(age, maxAge);
+			age = _mm_or_si128(_mm_and_si128(old, maxAge), _mm_andnot_si128(old, age));
+
+			// No gather before AVX2
+			alignas(16) uint32_t ages[4];
+			_mm_store_si128((__m128i*)ages, age);
+			__m128i alpha = _mm_setr_epi32((int)fadeTable[ages[0]], (int)fadeTable[ages[1]], (int)fadeTable[ages[2]], (int)fadeTable[ages[3]]);
+
+			_mm_storeu_si128((__m128i*)(dst + j * 4), _mm_or_si128(rgb, alpha));
+		}
+
+		while(bits)
+		{
+			int k = 0;
+			while(!(bits & (1 << k)))
+				k++;
+			litColumns[numLit++] = j + k;
+			bits &= bits - 1;
+		}
+	}
+
+	int tail = ProcessRowScalar(src + j, stamps + j, dst ? dst + j * 4 : nullptr, width - j, options, litColumns + numLit);
+	for(int k = 0; k < tail; k++)
+		litColumns[numLit + k] += j;
+	return numLit + tail;
+}
+
+CT_TARGET_AVX2
+static int ProcessRowAvx2(const uint32_t* src, uint16_t* stamps, uint8_t* dst, int width, const PixelKernelOptions& options, int* litColumns)
+{
+	const __m256i threshold = _mm256_set1_epi8((char)options.threshold);
+	const __m256i rgbMask = _mm256_set1_epi32(0x00ffffff);
+	const __m256i draw = options.draw ? _mm256_set1_epi32(-1) : _mm256_setzero_si256();
+	const __m256i low16 = _mm256_set1_epi32(0xffff);
+	const __m256i now = _mm256_set1_epi32(options.now);
+	const __m256i elapsed = _mm256_set1_epi32(options.elapsed);
+	const __m256i maxAge = _mm256_set1_epi32(options.maxAge);
+	const int* fadeTable = (const int*)options.fadeTable;
+
+	// BGRX to RGB0 within every 32-bit lane
+	const __m256i swapRedBlue = _mm256_setr_epi8(
+		2, 1, 0, -1, 6, 5, 4, -1, 10, 9, 8, -1, 14, 13, 12, -1,
+		2, 1, 0, -1, 6, 5, 4, -1, 10, 9, 8, -1, 14, 13, 12, -1);
+
+	int numLit = 0;
+	int j = 0;
+	for(; j + 8 <= width; j += 8)
+	{
+		__m256i p = _mm256_loadu_si256((const __m256i*)(src + j));
+
+		__m256i rgb = _mm256_shuffle_epi8(p, swapRedBlue);
+
+		__m256i ge = _mm256_cmpeq_epi8(_mm256_max_epu8(p, threshold), p);
+		__m256i lit = _mm256_and_si256(_mm256_cmpeq_epi32(_mm256_and_si256(ge, rgbMask), rgbMask), draw);
+		int bits = _mm256_movemask_ps(_mm256_castsi256_ps(lit));
+
+		if(!bits && !dst)
+			continue;
+
+		__m256i stamp = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(stamps + j)));
+		if(bits)
+		{
+			__m256i litStamp = options.punch ? now : _mm256_and_si256(_mm256_add_epi32(stamp, elapsed), low16);
+			stamp = _mm256_blendv_epi8(stamp, litStamp, lit);
+
+			// The pack works within 128-bit lanes, gather both halves into the low one
+			__m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(stamp, stamp), 0x08);
+			_mm_storeu_si128((__m128i*)(stamps + j), _mm256_castsi256_si128(packed));
+		}
+
+		if(dst)
+		{
+			__m256i age = _mm256_min_epu32(_mm256_and_si256(_mm256_sub_epi32(now, stamp), low16), maxAge);
+			__m256i alpha = _mm256_i32gather_epi32(fadeTable, age, 4);
+
+			_mm256_storeu_si256((__m256i*)(dst + j * 4), _mm256_or_si256(rgb, alpha));
+		}
+
+		while(bits)
+		{
+			int k = 0;
+			while(!(bits & (1 << k)))
+				k++;
+			litColumns[numLit++] = j + k;
+			bits &= bits - 1;
+		}
+	}
+
+	int tail = ProcessRowScalar(src + j, stamps + j, dst ? dst + j * 4 : nullptr, width - j, options, litColumns + numLit);
+	for(int k = 0; k < tail; k++)
+		litColumns[numLit + k] += j;
+	return numLit + tail;
+}
+
+CT_TARGET_AVX2
+static void TileMaxAvx2(const uint32_t* src, int stride, int width, int height, uint8_t* tileMax)
+{
+	const int numTiles = width / BRIGHT_TILE_SIZE;
+	for(int first = 0; first < numTiles; first += TILE_MAX_CHUNK)
+	{
+		int count = std::min(numTiles - first, TILE_MAX_CHUNK);
+		__m256i maxima[TILE_MAX_CHUNK];
+		for(int t = 0; t < count; t++)
+			maxima[t] = _mm256_setzero_si256();
+
+		for(int i = 0; i < height; i++)
+		{
+			const uint32_t* p = src + (size_t)i * stride + first * BRIGHT_TILE_SIZE;
+			for(int t = 0; t < count; t++, p += BRIGHT_TILE_SIZE)
+			{
+				__m256i a = _mm256_loadu_si256((const __m256i*)p);
+				__m256i b = _mm256_loadu_si256((const __m256i*)(p + 8));
+				a = _mm256_min_epu8(a, _mm256_min_epu8(_mm256_srli_epi32(a, 8), _mm256_srli_epi32(a, 16)));
+				b = _mm256_min_epu8(b, _mm256_min_epu8(_mm256_srli_epi32(b, 8), _mm256_srli_epi32(b, 16)));
+				maxima[t] = _mm256_max_epu8(maxima[t], _mm256_max_epu8(a, b));
+			}
+		}
+
+		const __m128i byte = _mm_set1_epi32(0xff);
+		for(int t = 0; t < count; t++)
+		{
+			__m128i m = _mm_max_epu8(_mm256_castsi256_si128(maxima[t]), _mm256_extracti128_si256(maxima[t], 1));
+			m = _mm_and_si128(m, byte);
+			m = _mm_max_epu8(m, _mm_srli_si128(m, 8));
+			m = _mm_max_epu8(m, _mm_srli_si128(m, 4));
+			tileMax[first + t] = (uint8_t)_mm_cvtsi128_si32(m);
+		}
+	}
+
+	if(numTiles * BRIGHT_TILE_SIZE < width)
+		TileMaxScalar(src + numTiles * BRIGHT_TILE_SIZE, stride, width - numTiles * BRIGHT_TILE_SIZE, height, tileMax + numTiles);
+}
+#endif
+
+const char* KernelIsaName(KernelIsa isa)
+{
+	switch(isa)
+	{
+	case KernelIsa::SCALAR: return "scalar";
+	case KernelIsa::SSE2: return "sse2";
+	case KernelIsa::AVX2: return "avx2";
+	}
+	return "?";
+}
+
+bool KernelIsaSupported(KernelIsa isa)
+{
+	const CpuFeatures& cpu = GetCpuFeatures();
+	switch(isa)
+	{
+	case KernelIsa::SCALAR: return true;
+	case KernelIsa::SSE2: return CT_X86 && cpu.sse2;
+	case KernelIsa::AVX2: return CT_X86 && cpu.avx2;
+	}
+	return false;
+}
+
+KernelIsa BestKernelIsa()
+{
+	if(KernelIsaSupported(KernelIsa::AVX2))
+		return KernelIsa::AVX2;
+	if(KernelIsaSupported(KernelIsa::SSE2))
+		return KernelIsa::SSE2;
+	return KernelIsa::SCALAR;
+}
+
+PixelRowKernel GetPixelRowKernel(KernelIsa isa)
+{
+#if CT_X86
+	if(isa == KernelIsa::AVX2 && KernelIsaSupported(isa))
+		return ProcessRowAvx2;
+	if(isa == KernelIsa::SSE2 && KernelIsaSupported(isa))
+		return ProcessRowSse2;
+#endif
+	return ProcessRowScalar;
+}
+
+TileMaxKernel GetTileMaxKernel(KernelIsa isa)
+{
+#if CT_X86
+	if(isa == KernelIsa::AVX2 && KernelIsaSupported(isa))
+		return TileMaxAvx2;
+	if(isa == KernelIsa::SSE2 && KernelIsaSupported(isa))
+		return TileMaxSse2;
+#endif
+	return TileMaxScalar;
+}
+
+bool PixelKernelSelfTest()
+{
+	// xorshift32, so every run tests the same rows
+	uint32_t state = 12345;
+	auto random = [&state]()
+	{
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return state;
+	};
+
+	const KernelIsa isas[] = { KernelIsa::SSE2, KernelIsa::AVX2 };
+	const int widths[] = { 1, 3, 4, 7, 8, 9, 15, 16, 17, 31, 33, 64, 67, 640, 1280 };
+
+	for(int width : widths)
+	for(int flags = 0; flags < 8; flags++)
+	for(int round = 0; round < 4; round++)
+	{
+		PixelKernelOptions options;
+		options.draw = (flags & 1) != 0;
+		options.punch = (flags & 2) != 0;
+		bool writeImage = (flags & 4) != 0;
+		options.threshold = round == 0 ? 255 : (uint8_t)(random() | 0x80);
+		options.now = (uint16_t)random();
+		options.elapsed = (uint16_t)(random() % 4);
+
+		// Any table will do, the kernels only have to agree on it
+		std::vector<uint32_t> fadeTable(1 + random() % 300);
+		for(uint32_t& alpha : fadeTable)
+			alpha = random() << 24;
+		options.fadeTable = fadeTable.data();
+		options.maxAge = (uint16_t)(fadeTable.size() - 1);
+
+		// Channels cluster around the threshold so both sides get exercised
+		std::vector<uint32_t> src(width);
+		std::vector<uint16_t> stamps(width);
+		for(int j = 0; j < width; j++)
+		{
+			uint32_t p = random();
+			for(int c = 0; c < 3; c++)
+			{
+				if(random() & 1)
+				{
+					uint8_t v = (uint8_t)(options.threshold - 1 + (random() % 3));
+					p = (p & ~(0xffu << (8 * c))) | ((uint32_t)v << (8 * c));
+				}
+			}
+			src[j] = p;
+
+			// Mostly young pixels, some far past the end of the table
+			stamps[j] = (uint16_t)(options.now - ((random() & 3) ? random() % 400 : random()));
+		}
+		std::vector<uint8_t> dst(width * 4);
+
+		std::vector<uint8_t> expected = dst;
+		std::vector<uint16_t> expectedStamps = stamps;
+		std::vector<int> expectedLit(width);
+		int expectedCount = ProcessRowScalar(src.data(), expectedStamps.data(), writeImage ? expected.data() : nullptr, width, options, expectedLit.data());
+
+		for(KernelIsa isa : isas)
+		{
+			if(!KernelIsaSupported(isa))
+				continue;
+
+			std::vector<uint8_t> actual = dst;
+			std::vector<uint16_t> actualStamps = stamps;
+			std::vector<int> actualLit(width);
+			int count = GetPixelRowKernel(isa)(src.data(), actualStamps.data(), writeImage ? actual.data() : nullptr, width, options, actualLit.data());
+
+			bool same = count == expectedCount && actual == expected && actualStamps == expectedStamps &&
+				std::equal(actualLit.begin(), actualLit.begin() + count, expectedLit.begin());
+			if(!same)
+			{
+				printf("Pixel kernel %s differs from scalar (width %d, draw %d, punch %d, image %d, threshold %d)\n",
+					KernelIsaName(isa), width, options.draw, options.punch, writeImage, options.threshold);
+				return false;
+			}
+		}
+	}
+
+	// Bright pixels are rare, so the tiles get a few scattered around a dim background
+	const int heights[] = { 1, 5, 16 };
+	for(int width : widths)
+	for(int height : heights)
+	{
+		int stride = width + (int)(random() % 5);
+		std::vector<uint32_t> src((size_t)stride * height);
+		for(uint32_t& p : src)
+			p = (random() % 16) ? random() & 0xff7f7f7f : random();
+
+		int numTiles = (width + BRIGHT_TILE_SIZE - 1) / BRIGHT_TILE_SIZE;
+		std::vector<uint8_t> expected(numTiles);
+		TileMaxScalar(src.data(), stride, width, height, expected.data());
+
+		for(KernelIsa isa : isas)
+		{
+			if(!KernelIsaSupported(isa))
+				continue;
+
+			std::vector<uint8_t> actual(numTiles, 0xaa);
+			GetTileMaxKernel(isa)(src.data(), stride, width, height, actual.data());
+			if(actual != expected)
+			{
+				printf("Tile max kernel %s differs from scalar (width %d, height %d)\n", KernelIsaName(isa), width, height);
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
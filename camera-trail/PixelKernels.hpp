@@ -0,0 +1,56 @@
+#pragma once
+#include <cstdint>
+
+// The per-pixel work of Canvas::ProcessFrame, one row at a time: unpack the
+// camera's BGRX ints to RGBA, test R, G and B against the threshold, stamp the
+// pixels that are lit, and look the alpha up from how long ago each pixel was
+// last lit. Nothing but the stamps of lit pixels is ever read back.
+
+enum class KernelIsa
+{
+	SCALAR,
+	SSE2,
+	AVX2
+};
+
+struct PixelKernelOptions
+{
+	uint8_t threshold = 255;
+	bool draw = true;	// Look for light at all
+	bool punch = true;	// Lit pixels restart their fade, otherwise their age stays where it was
+
+	// Stamps are ticks of the fade clock, ages are taken modulo 2^16
+	uint16_t now = 0;
+	uint16_t elapsed = 0;	// Ticks since the previous frame, added to lit pixels that are not punched
+
+	// Alpha for every age, already shifted into the top byte. Ages past maxAge
+	// use fadeTable[maxAge].
+	const uint32_t* fadeTable = nullptr;
+	uint16_t maxAge = 0;
+};
+
+// Processes width pixels from src into dst (4 bytes each), updating the
+// stamps of lit pixels. With dst nullptr only the light is looked for. Writes
+// the columns of lit pixels, left to right, into litColumns (room for width
+// entries) and returns how many there were.
+typedef int (*PixelRowKernel)(const uint32_t* src, uint16_t* stamps, uint8_t* dst, int width, const PixelKernelOptions& options, int* litColumns);
+
+// Writes the brightest min(R, G, B) of every BRIGHT_TILE_SIZE wide column of
+// the given rows into tileMax, one byte per column, the last one possibly
+// narrower. A pixel can only pass the threshold where its tile does, so
+// tiles below it need no closer look.
+const int BRIGHT_TILE_SIZE = 16;
+typedef void (*TileMaxKernel)(const uint32_t* src, int stride, int width, int height, uint8_t* tileMax);
+
+const char* KernelIsaName(KernelIsa isa);
+bool KernelIsaSupported(KernelIsa isa);
+
+// The fastest one this CPU supports
+KernelIsa BestKernelIsa();
+
+PixelRowKernel GetPixelRowKernel(KernelIsa isa);
+TileMaxKernel GetTileMaxKernel(KernelIsa isa);
+
+// Runs randomized rows and tiles through every supported kernel and checks they all
+// produce exactly what the scalar one does. Prints the first mismatch.
+bool PixelKernelSelfTest();
@@ -0,0 +1,227 @@
+#include "ReplaySource.hpp"
+#include "FrameCodec.hpp"
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+ReplaySource::ReplaySource(const ReplayParams& params)
+	: params(params)
+{
+}
+
+ReplaySource::~ReplaySource()
+{
+	Unmap();
+}
+
+bool ReplaySource::Map(const char* path)
+{
+#ifdef _WIN32
+	HANDLE f = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if(f == INVALID_HANDLE_VALUE)
+		return false;
+	file = f;
+
+	LARGE_INTEGER fileSize;
+	if(!GetFileSizeEx(f, &fileSize) || fileSize.QuadPart == 0)
+		return false;
+	size = (size_t)fileSize.QuadPart;
+
+	mapping = CreateFileMappingA(f, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if(!mapping)
+		return false;
+
+	data = (const uint8_t*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	return data != nullptr;
+#else
+	file = open(path, O_RDONLY);
+	if(file < 0)
+		return false;
+
+	struct stat st;
+	if(fstat(file, &st) != 0 || st.st_size == 0)
+		return false;
+	size = (size_t)st.st_size;
+
+	void* p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+	if(p == MAP_FAILED)
+		return false;
+
+	// Frames are read front to back
+	madvise(p, size, MADV_SEQUENTIAL);
+	data = (const uint8_t*)p;
+	return true;
+#endif
+}
+
+void ReplaySource::Unmap()
+{
+#ifdef _WIN32
+	if(data)
+		UnmapViewOfFile(data);
+	if(mapping)
+		CloseHandle(mapping);
+	if(file)
+		CloseHandle(file);
+	mapping = nullptr;
+	file = nullptr;
+#else
+	if(data)
+		munmap((void*)data, size);
+	if(file >= 0)
+		close(file);
+	file = -1;
+#endif
+	data = nullptr;
+	size = 0;
+}
+
+bool ReplaySource::Open(const char* path)
+{
+	if(!Map(path))
+	{
+		printf("Could not open recording %s\n", path);
+		Unmap();
+		return false;
+	}
+
+	const SessionHeader* header = (const SessionHeader*)data;
+	if(size < sizeof(SessionHeader) || memcmp(header->magic, SESSION_MAGIC, sizeof(SESSION_MAGIC)) != 0 ||
+	   header->version != SESSION_VERSION || header->width == 0 || header->width > SESSION_MAX_SIZE ||
+	   header->height == 0 || header->height > SESSION_MAX_SIZE)
+	{
+		printf("%s is not a camera-trail recording\n", path);
+		Unmap();
+		return false;
+	}
+
+	codec = header->codec;
+	if(codec != SessionCodec::RAW && codec != SessionCodec::DELTA_RLE)
+	{
+		printf("%s uses an unknown codec (%u)\n", path, (unsigned)codec);
+		Unmap();
+		return false;
+	}
+
+	width = (int)header->width;
+	height = (int)header->height;
+
+	// Trust the file over the header, the recording may have been cut short
+	double duration = 0.0;
+	if(codec == SessionCodec::RAW)
+	{
+		uint64_t framesInFile = (size - sizeof(SessionHeader)) / RawFrameSize(width, height);
+		frameCount = header->frameCount ? std::min<uint64_t>(header->frameCount, framesInFile) : framesInFile;
+		if(frameCount > 0)
+		{
+			const uint8_t* last = data + sizeof(SessionHeader) + (frameCount - 1) * RawFrameSize(width, height);
+			SessionFrameHeader frameHeader;
+			memcpy(&frameHeader, last, sizeof(frameHeader));
+			duration = frameHeader.timestamp;
+		}
+	}
+	else
+	{
+		// Encoded frames vary in size, walk them to find the complete ones
+		frameCount = 0;
+		size_t offset = sizeof(SessionHeader);
+		SessionFrameHeader frameHeader;
+		uint64_t payload;
+		while(size - offset >= sizeof(frameHeader) + sizeof(payload))
+		{
+			memcpy(&frameHeader, data + offset, sizeof(frameHeader));
+			memcpy(&payload, data + offset + sizeof(frameHeader), sizeof(payload));
+			if(payload > size - offset - sizeof(frameHeader) - sizeof(payload))
+				break;
+
+			offset += sizeof(frameHeader) + sizeof(payload) + (size_t)payload;
+			duration = frameHeader.timestamp;
+			frameCount++;
+		}
+
+		decoded.resize((size_t)width * height);
+	}
+
+	if(frameCount == 0)
+	{
+		printf("%s has no frames\n", path);
+		Unmap();
+		return false;
+	}
+
+	passLength = duration + (frameCount > 1 ? duration / (frameCount - 1) : 1.0 / 60.0);
+
+	start = std::chrono::steady_clock::now();
+	return true;
+}
+
+bool ReplaySource::NextFrame(Frame& frame, uint32_t* scratch)
+{
+	if(index == frameCount)
+	{
+		if(!params.loop)
+			return false;
+
+		// Keep time running forwards across passes
+		loopOffset += passLength;
+		index = 0;
+	}
+
+	SessionFrameHeader frameHeader;
+	const uint32_t* pixels;
+	if(codec == SessionCodec::RAW)
+	{
+		// Straight out of the mapping
+		const uint8_t* p = data + sizeof(SessionHeader) + index * RawFrameSize(width, height);
+		memcpy(&frameHeader, p, sizeof(frameHeader));
+		pixels = (const uint32_t*)(p + sizeof(SessionFrameHeader));
+	}
+	else
+	{
+		// Every pass starts over from opaque black
+		if(index == 0)
+		{
+			offset = sizeof(SessionHeader);
+			std::fill(decoded.begin(), decoded.end(), 0xff000000);
+		}
+
+		uint64_t payload;
+		memcpy(&frameHeader, data + offset, sizeof(frameHeader));
+		memcpy(&payload, data + offset + sizeof(frameHeader), sizeof(payload));
+		offset += sizeof(frameHeader) + sizeof(payload);
+
+		if(!DecodeDeltaRle(data + offset, (size_t)payload, decoded.data(), decoded.size()))
+		{
+			printf("Frame %llu of the recording is corrupt\n", (unsigned long long)index);
+			return false;
+		}
+		offset += (size_t)payload;
+
+		// The decoded frame is the base for the next one, so hand out a copy
+		memcpy(scratch, decoded.data(), decoded.size() * sizeof(uint32_t));
+		pixels = scratch;
+	}
+
+	double timestamp = loopOffset + frameHeader.timestamp;
+	if(params.pacing == ReplayPacing::REAL_TIME)
+		std::this_thread::sleep_until(start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(timestamp)));
+
+	frame.pixels = pixels;
+	frame.width = width;
+	frame.height = height;
+	frame.timestamp = timestamp;
+
+	index++;
+	return true;
+}
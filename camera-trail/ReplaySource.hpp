@@ -0,0 +1,62 @@
+#pragma once
+#include "FrameSource.hpp"
+#include "SessionFile.hpp"
+#include <chrono>
+#include <vector>
+
+enum class ReplayPacing
+{
+	REAL_TIME,	// Frames come out at the rate they were recorded at
+	FAST	// Frames come out as fast as they are asked for
+};
+
+struct ReplayParams
+{
+	ReplayPacing pacing = ReplayPacing::REAL_TIME;
+	bool loop = false;	// Start over after the last frame instead of stopping
+};
+
+// Plays back a recorded session. The file is memory mapped and frames of RAW
+// sessions are handed out as pointers straight into the mapping, without
+// copying. DELTA_RLE sessions are decoded frame by frame.
+class ReplaySource : public FrameSource
+{
+public:
+	explicit ReplaySource(const ReplayParams& params);
+	~ReplaySource();
+
+	bool Open(const char* path);
+
+	int Width() const override { return width; }
+	int Height() const override { return height; }
+	uint64_t FrameCount() const { return frameCount; }
+	bool NextFrame(Frame& frame, uint32_t* scratch) override;
+
+private:
+	bool Map(const char* path);
+	void Unmap();
+
+	ReplayParams params;
+
+	const uint8_t* data = nullptr;
+	size_t size = 0;
+#ifdef _WIN32
+	void* file = nullptr;
+	void* mapping = nullptr;
+#else
+	int file = -1;
+#endif
+
+	SessionCodec codec = SessionCodec::RAW;
+	int width = 0;
+	int height = 0;
+	uint64_t frameCount = 0;
+	uint64_t index = 0;
+	double passLength = 0.0;	// Recorded duration plus one frame
+	double loopOffset = 0.0;	// Added to the recorded timestamps on every pass
+	std::chrono::steady_clock::time_point start;
+
+	// DELTA_RLE only
+	size_t offset = 0;	// Where the next frame starts in the file
+	std::vector<uint32_t> decoded;	// Last decoded frame
+};
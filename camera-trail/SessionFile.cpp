@@ -0,0 +1,69 @@
+#include "SessionFile.hpp"
+#include <cstring>
+
+void InitSessionHeader(SessionHeader& header, int width, int height, SessionCodec codec)
+{
+	memcpy(header.magic, SESSION_MAGIC, sizeof(header.magic));
+	header.version = SESSION_VERSION;
+	header.width = (uint32_t)width;
+	header.height = (uint32_t)height;
+	header.codec = codec;
+	header.reserved = 0;
+	header.frameCount = 0;
+}
+
+RawSessionWriter::~RawSessionWriter()
+{
+	Close();
+}
+
+bool RawSessionWriter::Open(const char* path, int width, int height)
+{
+	file = fopen(path, "wb");
+	if(!file)
+	{
+		printf("Could not create %s\n", path);
+		return false;
+	}
+
+	InitSessionHeader(header, width, height, SessionCodec::RAW);
+
+	// Written again with the final frame count on Close()
+	return fwrite(&header, sizeof(header), 1, file) == 1;
+}
+
+bool RawSessionWriter::Write(const Frame& frame)
+{
+	if(!file || frame.width != (int)header.width || frame.height != (int)header.height)
+		return false;
+
+	if(header.frameCount == 0)
+		firstTimestamp = frame.timestamp;
+
+	SessionFrameHeader frameHeader;
+	frameHeader.timestamp = frame.timestamp - firstTimestamp;
+	frameHeader.sequence = frame.sequence;
+
+	size_t numPixels = (size_t)frame.width * frame.height;
+	if(fwrite(&frameHeader, sizeof(frameHeader), 1, file) != 1 ||
+	   fwrite(frame.pixels, sizeof(uint32_t), numPixels, file) != numPixels)
+	{
+		printf("Writing the recording failed, stopping it.\n");
+		Close();
+		return false;
+	}
+
+	header.frameCount++;
+	return true;
+}
+
+void RawSessionWriter::Close()
+{
+	if(!file)
+		return;
+
+	fseek(file, 0, SEEK_SET);
+	fwrite(&header, sizeof(header), 1, file);
+	fclose(file);
+	file = nullptr;
+}
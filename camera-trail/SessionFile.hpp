@@ -0,0 +1,63 @@
+#pragma once
+#include "FrameSource.hpp"
+#include <cstdio>
+
+// A recorded session is a SessionHeader followed by frameCount frames. In a RAW
+// session every frame is a SessionFrameHeader followed by width * height pixels
+// in mTargetBuf layout, so frames sit at fixed offsets and can be mapped
+// straight into memory. In a DELTA_RLE session every frame is a
+// SessionFrameHeader, the payload size as a uint64_t and the payload produced by
+// EncodeDeltaRle (see FrameCodec.hpp).
+
+const char SESSION_MAGIC[4] = { 'C', 'T', 'R', 'S' };
+const uint32_t SESSION_VERSION = 1;
+const uint32_t SESSION_MAX_SIZE = 16384;	// Largest width or height a recording can have
+
+enum class SessionCodec : uint32_t
+{
+	RAW = 0,
+	DELTA_RLE = 1
+};
+
+struct SessionHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t width;
+	uint32_t height;
+	SessionCodec codec;
+	uint32_t reserved;
+	uint64_t frameCount;	// 0 if the recording was cut short; count the frames instead
+};
+
+struct SessionFrameHeader
+{
+	double timestamp;	// Seconds since the recording started
+	uint64_t sequence;	// Sequence number the frame had when it was captured
+};
+
+static_assert(sizeof(SessionHeader) == 32, "SessionHeader must match the file layout");
+static_assert(sizeof(SessionFrameHeader) == 16, "SessionFrameHeader must match the file layout");
+
+void InitSessionHeader(SessionHeader& header, int width, int height, SessionCodec codec);
+
+inline size_t RawFrameSize(int width, int height)
+{
+	return sizeof(SessionFrameHeader) + (size_t)width * height * sizeof(uint32_t);
+}
+
+// Writes a RAW session, frame by frame
+class RawSessionWriter
+{
+public:
+	~RawSessionWriter();
+
+	bool Open(const char* path, int width, int height);
+	bool Write(const Frame& frame);
+	void Close();
+
+private:
+	FILE* file = nullptr;
+	SessionHeader header;
+	double firstTimestamp = 0.0;
+};
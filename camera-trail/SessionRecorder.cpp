@@ -0,0 +1,140 @@
+#include "SessionRecorder.hpp"
+#include "FrameCodec.hpp"
+#include "Trace.hpp"
+#include <chrono>
+#include <cstring>
+
+SessionRecorder::SessionRecorder(int width, int height, size_t queueFrames)
+	: width(width), height(height), queue(queueFrames)
+{
+}
+
+SessionRecorder::~SessionRecorder()
+{
+	Close();
+}
+
+bool SessionRecorder::Open(const char* path)
+{
+	file = fopen(path, "wb");
+	if(!file)
+	{
+		printf("Could not create %s\n", path);
+		return false;
+	}
+
+	// Written again with the final frame count on Close()
+	InitSessionHeader(header, width, height, SessionCodec::DELTA_RLE);
+	if(fwrite(&header, sizeof(header), 1, file) != 1)
+	{
+		fclose(file);
+		file = nullptr;
+		return false;
+	}
+
+	// Only a recorder that records holds frames
+	size_t numPixels = (size_t)width * height;
+	for(QueuedFrame& item : queue.Items())
+		item.pixels.resize(numPixels);
+	previous.assign(numPixels, 0xff000000);
+	encoded.resize(MaxEncodedSize(numPixels));
+	first = true;
+
+	running = true;
+	thread = std::thread(&SessionRecorder::WriterLoop, this);
+	return true;
+}
+
+void SessionRecorder::Close()
+{
+	if(!file)
+		return;
+
+	running = false;
+	if(thread.joinable())
+		thread.join();
+
+	fseek(file, 0, SEEK_SET);
+	fwrite(&header, sizeof(header), 1, file);
+	fclose(file);
+	file = nullptr;
+
+	for(QueuedFrame& item : queue.Items())
+		std::vector<uint32_t>().swap(item.pixels);
+	std::vector<uint32_t>().swap(previous);
+	std::vector<uint8_t>().swap(encoded);
+
+	printf("Recorded %llu frames, dropped %llu\n", (unsigned long long)Written(), (unsigned long long)Dropped());
+}
+
+void SessionRecorder::Submit(const Frame& frame)
+{
+	if(!running.load(std::memory_order_relaxed) || frame.width != width || frame.height != height)
+		return;
+
+	QueuedFrame* item = queue.BeginPush();
+	if(!item)
+	{
+		dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	memcpy(item->pixels.data(), frame.pixels, item->pixels.size() * sizeof(uint32_t));
+	item->header.timestamp = frame.timestamp;
+	item->header.sequence = frame.sequence;
+	queue.EndPush();
+}
+
+void SessionRecorder::WriterLoop()
+{
+	TraceSetThreadName("recorder");
+
+	for(;;)
+	{
+		QueuedFrame* item = queue.Front();
+		if(!item)
+		{
+			// Keep going until everything submitted before Close() is on disk
+			if(!running.load(std::memory_order_acquire))
+				break;
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(2));
+			continue;
+		}
+
+		bool ok = WriteFrame(*item);
+		queue.Pop();
+		if(!ok)
+		{
+			printf("Writing the recording failed, stopping it.\n");
+			running = false;
+			break;
+		}
+	}
+}
+
+bool SessionRecorder::WriteFrame(const QueuedFrame& frame)
+{
+	if(first)
+	{
+		firstTimestamp = frame.header.timestamp;
+		first = false;
+	}
+
+	TraceScope scope("encode + write");
+
+	size_t numPixels = frame.pixels.size();
+	uint64_t size = EncodeDeltaRle(frame.pixels.data(), previous.data(), numPixels, encoded.data());
+	memcpy(previous.data(), frame.pixels.data(), numPixels * sizeof(uint32_t));
+
+	SessionFrameHeader frameHeader = frame.header;
+	frameHeader.timestamp -= firstTimestamp;
+	if(fwrite(&frameHeader, sizeof(frameHeader), 1, file) != 1 ||
+	   fwrite(&size, sizeof(size), 1, file) != 1 ||
+	   fwrite(encoded.data(), 1, (size_t)size, file) != size)
+		return false;
+
+	header.frameCount++;
+	written.fetch_add(1, std::memory_order_relaxed);
+	return true;
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include "FrameSource.hpp"
+#include "SessionFile.hpp"
+#include "SpscQueue.hpp"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// Records a DELTA_RLE session in the background. Submit() only copies the frame
+// into a free queue slot; encoding and writing happen on the recorder's own
+// thread. If that thread falls behind and the queue is full, frames are dropped
+// and counted instead of holding up the caller.
+class SessionRecorder : public FrameSink
+{
+public:
+	// Nothing the size of a frame is allocated until Open()
+	SessionRecorder(int width, int height, size_t queueFrames = 8);
+	~SessionRecorder();
+
+	bool Open(const char* path);
+
+	// Writes out everything still queued and finishes the file
+	void Close();
+
+	void Submit(const Frame& frame) override;
+
+	uint64_t Written() const { return written.load(std::memory_order_relaxed); }
+	uint64_t Dropped() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+	struct QueuedFrame
+	{
+		std::vector<uint32_t> pixels;
+		SessionFrameHeader header;
+	};
+
+	void WriterLoop();
+	bool WriteFrame(const QueuedFrame& frame);
+
+	int width;
+	int height;
+	SpscQueue<QueuedFrame> queue;
+
+	FILE* file = nullptr;
+	SessionHeader header;
+	std::vector<uint32_t> previous;
+	std::vector<uint8_t> encoded;
+	bool first = true;
+	double firstTimestamp = 0.0;
+
+	std::thread thread;
+	std::atomic<bool> running { false };
+	std::atomic<uint64_t> written { 0 };
+	std::atomic<uint64_t> dropped { 0 };
+};
@@ -0,0 +1,158 @@
+#include "SparseLife.hpp"
+#include <algorithm>
+
+void SparseLife::Resize(int newRows, int newColumns)
+{
+	rows = newRows;
+	columns = newColumns;
+	tileRows = (rows + TILE_ROWS - 1) / TILE_ROWS;
+	tileColumns = (columns + 63) / 64;
+	maskWords = (tileColumns + 63) / 64;
+	changed = std::vector<std::atomic<uint64_t>>((size_t)tileRows * maskWords);
+	spread.assign(changed.size(), 0);
+	awake.assign(changed.size(), 0);
+	differences.assign((size_t)tileRows * tileColumns, 0);
+	runs.clear();
+	numActive = 0;
+	TouchAll();
+}
+
+void SparseLife::TouchAll()
+{
+	for(int ty = 0; ty < tileRows; ty++)
+	for(int i = 0; i < maskWords; i++)
+	{
+		int bits = std::min(tileColumns - i * 64, 64);
+		changed[(size_t)ty * maskWords + i].store(bits == 64 ? ~0ull : (1ull << bits) - 1, std::memory_order_relaxed);
+	}
+}
+
+void SparseLife::Step(BitGrid& grid, BitGrid& next, LifeRowKernel kernel, WorkerPool* workers, Boundary boundary)
+{
+	// Every tile next to one that changed wakes up, spread sideways within the
+	// tile rows and then to the rows above and below. The ends of the grid
+	// always wake the other end too, which only TORUS needs, a few more tiles
+	// than needed with the other boundaries.
+	const int last = tileColumns - 1;
+	const uint64_t lastWordMask = tileColumns % 64 ? (1ull << (tileColumns % 64)) - 1 : ~0ull;
+	for(int ty = 0; ty < tileRows; ty++)
+	{
+		uint64_t* bits = awake.data() + (size_t)ty * maskWords;
+		for(int i = 0; i < maskWords; i++)
+		{
+			std::atomic<uint64_t>& word = changed[(size_t)ty * maskWords + i];
+			bits[i] = word.load(std::memory_order_relaxed);
+			if(bits[i])
+				word.store(0, std::memory_order_relaxed);
+		}
+
+		uint64_t* out = spread.data() + (size_t)ty * maskWords;
+		for(int i = 0; i < maskWords; i++)
+		{
+			uint64_t left = bits[i] << 1 | (i > 0 ? bits[i - 1] >> 63 : 0);
+			uint64_t right = bits[i] >> 1 | (i + 1 < maskWords ? bits[i + 1] << 63 : 0);
+			out[i] = bits[i] | left | right;
+		}
+		if(bits[0] & 1)
+			out[last / 64] |= 1ull << (last % 64);
+		if((bits[last / 64] >> (last % 64)) & 1)
+			out[0] |= 1;
+		out[maskWords - 1] &= lastWordMask;
+	}
+	for(int ty = 0; ty < tileRows; ty++)
+	{
+		const uint64_t* above = spread.data() + (size_t)(ty > 0 ? ty - 1 : tileRows - 1) * maskWords;
+		const uint64_t* row = spread.data() + (size_t)ty * maskWords;
+		const uint64_t* below = spread.data() + (size_t)(ty < tileRows - 1 ? ty + 1 : 0) * maskWords;
+		uint64_t* out = awake.data() + (size_t)ty * maskWords;
+		for(int i = 0; i < maskWords; i++)
+			out[i] = above[i] | row[i] | below[i];
+	}
+
+	// Awake tiles next to each other in a tile row are stepped together, so
+	// the kernel gets whole runs of words rather than one at a time
+	runs.clear();
+	numActive = 0;
+	for(int ty = 0; ty < tileRows; ty++)
+	{
+		for(int i = 0; i < maskWords; i++)
+		{
+			uint64_t bits = awake[(size_t)ty * maskWords + i];
+			while(bits)
+			{
+				int bit = LowestBit(bits);
+				uint64_t ones = ~(bits >> bit);
+				int length = ones ? LowestBit(ones) : 64;
+				bits = bit + length >= 64 ? 0 : bits & (~0ull << (bit + length));
+
+				int first = i * 64 + bit;
+				if(!runs.empty() && runs.back().tileRow == ty && runs.back().end == first)
+					runs.back().end += length;
+				else
+				{
+					Run run;
+					run.tileRow = ty;
+					run.first = first;
+					run.end = first + length;
+					runs.push_back(run);
+				}
+				numActive += length;
+			}
+		}
+	}
+
+	// Only runs at the edges of the grid read its halo
+	int haloRow = -1;
+	for(const Run& run : runs)
+	{
+		bool edge = run.first == 0 || run.end == tileColumns || run.tileRow == 0 || run.tileRow == tileRows - 1;
+		if(edge && run.tileRow != haloRow)
+		{
+			haloRow = run.tileRow;
+			grid.FillHalo(boundary, haloRow * TILE_ROWS, std::min((haloRow + 1) * TILE_ROWS, rows));
+		}
+	}
+
+	// Bits past the last column are the halo, not cells
+	const uint64_t lastMask = columns % 64 ? (1ull << (columns % 64)) - 1 : ~0ull;
+	auto stepRuns = [&](int task, int numTasks)
+	{
+		size_t first = runs.size() * task / numTasks;
+		size_t end = runs.size() * (task + 1) / numTasks;
+		for(size_t i = first; i < end; i++)
+		{
+			const Run& run = runs[i];
+			int firstRow = run.tileRow * TILE_ROWS;
+			int endRow = std::min(firstRow + TILE_ROWS, rows);
+			uint64_t* difference = differences.data() + (size_t)run.tileRow * tileColumns;
+			std::fill(difference + run.first, difference + run.end, 0);
+			for(int r = firstRow; r < endRow; r++)
+			{
+				uint64_t* out = next.Row(r);
+				const uint64_t* in = grid.Row(r);
+				kernel(grid.Row(r - 1) + run.first, in + run.first, grid.Row(r + 1) + run.first, out + run.first, run.end - run.first);
+				if(run.end == tileColumns)
+					out[last] &= lastMask;
+				for(int w = run.first; w < run.end; w++)
+					difference[w] |= out[w] ^ in[w];
+			}
+
+			// A tile that came out the same goes to sleep
+			if(run.end == tileColumns)
+				difference[last] &= lastMask;
+			for(int w = run.first; w < run.end; w++)
+			{
+				if(difference[w])
+					MarkChanged(run.tileRow, w);
+			}
+		}
+	};
+
+	if(workers && runs.size() > 1)
+	{
+		int numTasks = (int)std::min(runs.size(), (size_t)workers->NumThreads() * 4);
+		workers->Run(numTasks, [&](int task) { stepRuns(task, numTasks); }, "life tiles");
+	}
+	else
+		stepRuns(0, 1);
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include "BitGrid.hpp"
+#include "LifeKernels.hpp"
+#include "WorkerPool.hpp"
+#include <atomic>
+#include <vector>
+
+// Game of Life on a BitGrid that only steps the tiles where something can
+// still change: those that changed in the last generation, and the tiles
+// around them. Still lifes settle, their tiles stop changing and go to sleep,
+// and a grid that is mostly dead or settled costs next to nothing to step.
+//
+// Stepping goes from one grid into another, which are then swapped, so a
+// sleeping tile has to hold the same cells in both. That is how a tile falls
+// asleep, by being stepped into exactly what it was.
+class SparseLife
+{
+public:
+	// Tiles are one word, 64 cells, wide
+	static const int TILE_ROWS = 16;
+
+	void Resize(int rows, int columns);
+
+	// A cell was set or cleared in the grid outside of Step. Safe to call from
+	// several threads at once.
+	void Touch(int row, int column) { MarkChanged(row / TILE_ROWS, column / 64); }
+
+	// The whole grid may have changed, or the grid stepped into does not hold
+	// the same cells anymore
+	void TouchAll();
+
+	// One generation from grid into next, which the caller swaps in after. Only
+	// the active tiles are stepped, on the pool if there is one.
+	void Step(BitGrid& grid, BitGrid& next, LifeRowKernel kernel, WorkerPool* workers, Boundary boundary);
+
+	// Tiles the last Step stepped
+	int ActiveTiles() const { return numActive; }
+	int NumTiles() const { return tileRows * tileColumns; }
+
+private:
+	void MarkChanged(int tileRow, int tileColumn)
+	{
+		std::atomic<uint64_t>& word = changed[(size_t)tileRow * maskWords + tileColumn / 64];
+		uint64_t bit = 1ull << (tileColumn % 64);
+		if(!(word.load(std::memory_order_relaxed) & bit))
+			word.fetch_or(bit, std::memory_order_relaxed);
+	}
+
+	int rows = 0;
+	int columns = 0;
+	int tileRows = 0;
+	int tileColumns = 0;
+
+	// A bit per tile, maskWords words to a tile row, so that finding the few
+	// tiles that are awake in a big grid costs next to nothing
+	int maskWords = 0;
+	std::vector<std::atomic<uint64_t>> changed;	// Since the last Step, bands can share a word
+	std::vector<uint64_t> spread;	// Changed tiles and the ones either side
+	std::vector<uint64_t> awake;
+	std::vector<uint64_t> differences;	// Between the generations, of every word of a tile ORed together
+
+	// Awake tiles side by side in a tile row
+	struct Run
+	{
+		int tileRow;
+		int first;
+		int end;	// Exclusive
+	};
+
+	std::vector<Run> runs;
+	int numActive = 0;
+};
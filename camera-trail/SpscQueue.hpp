@@ -0,0 +1,54 @@
+#pragma once
+#include <atomic>
+#include <vector>
+
+// Bounded single producer, single consumer queue over preallocated items.
+// Neither side ever blocks or allocates: the producer fills an item in place
+// between BeginPush and EndPush, the consumer reads it between Front and Pop.
+template<typename T>
+class SpscQueue
+{
+public:
+	explicit SpscQueue(size_t capacity)
+		: items(capacity + 1)
+	{
+	}
+
+	// Item to fill, or nullptr if the queue is full
+	T* BeginPush()
+	{
+		size_t h = head.load(std::memory_order_relaxed);
+		if(Next(h) == tail.load(std::memory_order_acquire))
+			return nullptr;
+		return &items[h];
+	}
+
+	void EndPush()
+	{
+		head.store(Next(head.load(std::memory_order_relaxed)), std::memory_order_release);
+	}
+
+	// Oldest item, or nullptr if the queue is empty
+	T* Front()
+	{
+		size_t t = tail.load(std::memory_order_relaxed);
+		if(t == head.load(std::memory_order_acquire))
+			return nullptr;
+		return &items[t];
+	}
+
+	void Pop()
+	{
+		tail.store(Next(tail.load(std::memory_order_relaxed)), std::memory_order_release);
+	}
+
+	// Every item, so the owner can preallocate them before use
+	std::vector<T>& Items() { return items; }
+
+private:
+	size_t Next(size_t i) const { return i + 1 == items.size() ? 0 : i + 1; }
+
+	std::vector<T> items;
+	alignas(64) std::atomic<size_t> head { 0 };	// Written by the producer
+	alignas(64) std::atomic<size_t> tail { 0 };	// Written by the consumer
+};
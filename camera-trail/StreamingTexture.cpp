@@ -0,0 +1,191 @@
+#include "StreamingTexture.hpp"
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <SFML/OpenGL.hpp>
+
+// Nothing past OpenGL 1.1 can be linked to directly on Windows
+#ifndef APIENTRY
+#define APIENTRY
+#endif
+
+#ifndef GL_PIXEL_UNPACK_BUFFER
+#define GL_PIXEL_UNPACK_BUFFER 0x88EC
+#endif
+#ifndef GL_PIXEL_UNPACK_BUFFER_BINDING
+#define GL_PIXEL_UNPACK_BUFFER_BINDING 0x88EF
+#endif
+#ifndef GL_STREAM_DRAW
+#define GL_STREAM_DRAW 0x88E0
+#endif
+#ifndef GL_WRITE_ONLY
+#define GL_WRITE_ONLY 0x88B9
+#endif
+#ifndef GL_MAP_WRITE_BIT
+#define GL_MAP_WRITE_BIT 0x0002
+#endif
+#ifndef GL_MAP_INVALIDATE_BUFFER_BIT
+#define GL_MAP_INVALIDATE_BUFFER_BIT 0x0008
+#endif
+
+typedef void (APIENTRY* GenBuffersFunction)(GLsizei n, GLuint* buffers);
+typedef void (APIENTRY* DeleteBuffersFunction)(GLsizei n, const GLuint* buffers);
+typedef void (APIENTRY* BindBufferFunction)(GLenum target, GLuint buffer);
+typedef void (APIENTRY* BufferDataFunction)(GLenum target, ptrdiff_t size, const void* data, GLenum usage);
+typedef void* (APIENTRY* MapBufferFunction)(GLenum target, GLenum access);
+typedef void* (APIENTRY* MapBufferRangeFunction)(GLenum target, ptrdiff_t offset, ptrdiff_t length, GLbitfield access);
+typedef GLboolean (APIENTRY* UnmapBufferFunction)(GLenum target);
+
+struct BufferFunctions
+{
+	GenBuffersFunction genBuffers = nullptr;
+	DeleteBuffersFunction deleteBuffers = nullptr;
+	BindBufferFunction bindBuffer = nullptr;
+	BufferDataFunction bufferData = nullptr;
+	MapBufferFunction mapBuffer = nullptr;
+	MapBufferRangeFunction mapBufferRange = nullptr;	// Optional, OpenGL 3.0
+	UnmapBufferFunction unmapBuffer = nullptr;
+};
+
+static BufferFunctions gl;
+
+// Core names first, then the ARB extension that brought buffer objects
+static sf::GlFunctionPointer LoadFunction(const char* name, const char* arbName)
+{
+	sf::GlFunctionPointer function = sf::Context::getFunction(name);
+	return function ? function : sf::Context::getFunction(arbName);
+}
+
+static bool LoadBufferFunctions()
+{
+	if(gl.genBuffers)
+		return true;
+
+	BufferFunctions functions;
+	functions.genBuffers = (GenBuffersFunction)LoadFunction("glGenBuffers", "glGenBuffersARB");
+	functions.deleteBuffers = (DeleteBuffersFunction)LoadFunction("glDeleteBuffers", "glDeleteBuffersARB");
+	functions.bindBuffer = (BindBufferFunction)LoadFunction("glBindBuffer", "glBindBufferARB");
+	functions.bufferData = (BufferDataFunction)LoadFunction("glBufferData", "glBufferDataARB");
+	functions.mapBuffer = (MapBufferFunction)LoadFunction("glMapBuffer", "glMapBufferARB");
+	functions.mapBufferRange = (MapBufferRangeFunction)sf::Context::getFunction("glMapBufferRange");
+	functions.unmapBuffer = (UnmapBufferFunction)LoadFunction("glUnmapBuffer", "glUnmapBufferARB");
+
+	// Buffer objects alone are not enough, they also have to work as a pixel
+	// source, which is core since OpenGL 2.1
+	int major = 0;
+	int minor = 0;
+	const char* version = (const char*)glGetString(GL_VERSION);
+	if(version)
+		sscanf(version, "%d.%d", &major, &minor);
+	bool pixelBuffers = major > 2 || (major == 2 && minor >= 1) ||
+		sf::Context::isExtensionAvailable("GL_ARB_pixel_buffer_object") ||
+		sf::Context::isExtensionAvailable("GL_EXT_pixel_buffer_object");
+
+	if(!pixelBuffers || !functions.genBuffers || !functions.deleteBuffers || !functions.bindBuffer ||
+		!functions.bufferData || !functions.mapBuffer || !functions.unmapBuffer)
+		return false;
+
+	gl = functions;
+	return true;
+}
+
+StreamingTexture::~StreamingTexture()
+{
+	DeleteBuffers();
+}
+
+bool StreamingTexture::Create(unsigned width, unsigned height, bool usePixelBuffers, int numBuffers)
+{
+	DeleteBuffers();
+
+	if(!texture.create(width, height))
+		return false;
+	this->width = width;
+	this->height = height;
+
+	if(!usePixelBuffers || numBuffers <= 0)
+		return true;
+
+	if(!LoadBufferFunctions())
+	{
+		printf("Pixel buffer objects are not supported, uploading directly\n");
+		return true;
+	}
+
+	buffers.resize(numBuffers);
+	gl.genBuffers(numBuffers, buffers.data());
+	for(unsigned buffer : buffers)
+	{
+		gl.bindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+		gl.bufferData(GL_PIXEL_UNPACK_BUFFER, (ptrdiff_t)width * height * 4, nullptr, GL_STREAM_DRAW);
+	}
+	gl.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	next = 0;
+	pending = false;
+
+	return true;
+}
+
+void StreamingTexture::Update(const uint8_t* pixels)
+{
+	if(buffers.empty())
+	{
+		texture.update(pixels);
+		return;
+	}
+
+	// The pixels written last time go into the texture first, so the GPU
+	// copies them out of their buffer while the CPU fills the next one below
+	const size_t previous = (next + buffers.size() - 1) % buffers.size();
+	if(pending)
+		UploadFrom(buffers[previous]);
+
+	// That buffer was last read by the upload of a whole ring ago, which has
+	// long finished, so writing it does not wait for the GPU
+	const ptrdiff_t size = (ptrdiff_t)width * height * 4;
+	const size_t current = next;
+	gl.bindBuffer(GL_PIXEL_UNPACK_BUFFER, buffers[current]);
+	void* mapped = gl.mapBufferRange
+		? gl.mapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT)
+		: gl.mapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY);
+	if(!mapped)
+	{
+		gl.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		texture.update(pixels);
+		pending = false;
+		return;
+	}
+	memcpy(mapped, pixels, size);
+	gl.unmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+	next = (next + 1) % buffers.size();
+
+	// With nothing in the texture yet there is nothing to show meanwhile, so
+	// the first image goes in right away as well
+	if(!pending)
+		UploadFrom(buffers[current]);
+	pending = true;
+
+	// sf::Texture::update would read from the buffer otherwise
+	gl.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void StreamingTexture::UploadFrom(unsigned buffer)
+{
+	// SFML remembers which texture it bound last, so put the binding back the
+	// way it was. With a pixel buffer bound the last argument is an offset into it.
+	gl.bindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+	GLint previous = 0;
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &previous);
+	glBindTexture(GL_TEXTURE_2D, texture.getNativeHandle());
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, (GLsizei)width, (GLsizei)height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	glBindTexture(GL_TEXTURE_2D, (GLuint)previous);
+}
+
+void StreamingTexture::DeleteBuffers()
+{
+	if(!buffers.empty())
+	{
+		gl.deleteBuffers((GLsizei)buffers.size(), buffers.data());
+		buffers.clear();
+	}
+}
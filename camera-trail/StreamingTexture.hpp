@@ -0,0 +1,44 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <SFML/Graphics.hpp>
+
+// A texture that gets a whole new image every frame. The pixels are copied into
+// the next of a ring of OpenGL pixel buffer objects, and the texture is only
+// updated from that buffer on the next Update(), so the GPU transfers them
+// while the CPU works on the frame after. The texture therefore shows every
+// image one Update() late, except the very first. Falls back to
+// sf::Texture::update, with no delay, where pixel buffer objects are not
+// available.
+class StreamingTexture
+{
+public:
+	StreamingTexture() {}
+	~StreamingTexture();
+
+	StreamingTexture(const StreamingTexture&) = delete;
+	StreamingTexture& operator=(const StreamingTexture&) = delete;
+
+	// The window's context has to be active, here and in every Update()
+	bool Create(unsigned width, unsigned height, bool usePixelBuffers = true, int numBuffers = 3);
+
+	// width x height RGBA pixels
+	void Update(const uint8_t* pixels);
+
+	const sf::Texture& Texture() const { return texture; }
+	void SetSmooth(bool smooth) { texture.setSmooth(smooth); }
+	bool UsesPixelBuffers() const { return !buffers.empty(); }
+
+private:
+	void DeleteBuffers();
+
+	// Starts copying a filled buffer into the texture
+	void UploadFrom(unsigned buffer);
+
+	sf::Texture texture;
+	unsigned width = 0;
+	unsigned height = 0;
+	std::vector<unsigned> buffers;
+	size_t next = 0;
+	bool pending = false;	// The buffer before next holds pixels the texture does not have yet
+};
@@ -0,0 +1,94 @@
+#include "SyntheticSource.hpp"
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+SyntheticSource::SyntheticSource(const SyntheticParams& params)
+	: params(params), rngState(params.seed ? params.seed : 1)
+{
+	const float TWO_PI = 6.2831853f;
+	auto uniform = [this](float lo, float hi) { return lo + (hi - lo) * (Random() >> 8) / 16777216.0f; };
+
+	// Every blob sweeps its own Lissajous curve across the frame
+	for(int i = 0; i < params.blobs; i++)
+	{
+		Blob b;
+		b.centerX = params.width * uniform(0.3f, 0.7f);
+		b.centerY = params.height * uniform(0.3f, 0.7f);
+		b.radiusX = params.width * uniform(0.1f, 0.3f);
+		b.radiusY = params.height * uniform(0.1f, 0.3f);
+		b.speedX = uniform(0.5f, 3.0f);
+		b.speedY = uniform(0.5f, 3.0f);
+		b.phaseX = uniform(0.0f, TWO_PI);
+		b.phaseY = uniform(0.0f, TWO_PI);
+		blobs.push_back(b);
+	}
+
+	start = std::chrono::steady_clock::now();
+}
+
+uint32_t SyntheticSource::Random()
+{
+	// xorshift32, so the sequence is the same on every compiler and platform
+	rngState ^= rngState << 13;
+	rngState ^= rngState >> 17;
+	rngState ^= rngState << 5;
+	return rngState;
+}
+
+bool SyntheticSource::NextFrame(Frame& frame, uint32_t* scratch)
+{
+	const int width = params.width;
+	const int height = params.height;
+	const double frameTime = 1.0 / (params.fps > 0.0 ? params.fps : 60.0);
+	const double t = index * frameTime;
+
+	if(params.fps > 0.0)
+		std::this_thread::sleep_until(start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(t)));
+
+	// Noisy background. The noise never reaches full brightness, so only the blobs
+	// can cross the threshold.
+	const int span = 2 * params.noise + 1;
+	for(int i = 0; i < width * height; i += 4)
+	{
+		uint32_t r = Random();
+		for(int k = 0; k < 4 && i + k < width * height; k++)
+		{
+			int v = params.background + (int)(((r >> (8 * k)) & 0xff) * span >> 8) - params.noise;
+			v = std::min(std::max(v, 0), 254);
+			scratch[i + k] = 0xff000000 | (v << 16) | (v << 8) | v;
+		}
+	}
+
+	// Lights: a saturated core with a glow that fades into the background
+	const float radius = (float)params.blobRadius;
+	for(const Blob& b : blobs)
+	{
+		float x = b.centerX + b.radiusX * std::sin(b.speedX * (float)t + b.phaseX);
+		float y = b.centerY + b.radiusY * std::sin(b.speedY * (float)t + b.phaseY);
+
+		int x0 = std::max((int)(x - 2 * radius), 0);
+		int x1 = std::min((int)(x + 2 * radius) + 1, width);
+		int y0 = std::max((int)(y - 2 * radius), 0);
+		int y1 = std::min((int)(y + 2 * radius) + 1, height);
+		for(int i = y0; i < y1; i++)
+		for(int j = x0; j < x1; j++)
+		{
+			float d = std::sqrt((j - x) * (j - x) + (i - y) * (i - y));
+			uint32_t& p = scratch[i * width + j];
+			if(d <= radius)
+				p = 0xffffffff;
+			else if(d < 2 * radius)
+			{
+				int base = p & 0xff;
+				int v = std::max(base, (int)(base + (254 - base) * (2 - d / radius)));
+				p = 0xff000000 | (v << 16) | (v << 8) | v;
+			}
+		}
+	}
+
+	frame.pixels = scratch;
+	frame.timestamp = t;
+	index++;
+	return true;
+}
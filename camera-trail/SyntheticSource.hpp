@@ -0,0 +1,46 @@
+#pragma once
+#include "FrameSource.hpp"
+#include <chrono>
+#include <vector>
+
+struct SyntheticParams
+{
+	int width = 1280;
+	int height = 720;
+	double fps = 60.0;	// 0 hands out frames as fast as they are asked for
+	int blobs = 2;	// Number of moving lights
+	int blobRadius = 10;	// Radius of the saturated core, in pixels
+	int background = 60;	// Base brightness of the scene
+	int noise = 24;	// Amplitude of the per-pixel sensor noise
+	uint32_t seed = 1;
+};
+
+// Camera-free stand-in for a webcam pointed at someone waving a light pen:
+// bright blobs moving along smooth paths over a noisy background. The same
+// params and seed always produce exactly the same frames.
+class SyntheticSource : public FrameSource
+{
+public:
+	explicit SyntheticSource(const SyntheticParams& params);
+
+	int Width() const override { return params.width; }
+	int Height() const override { return params.height; }
+	bool NextFrame(Frame& frame, uint32_t* scratch) override;
+
+private:
+	struct Blob
+	{
+		float centerX, centerY;
+		float radiusX, radiusY;	// Size of the path the blob moves along
+		float speedX, speedY;	// Radians per second
+		float phaseX, phaseY;
+	};
+
+	uint32_t Random();
+
+	SyntheticParams params;
+	std::vector<Blob> blobs;
+	uint32_t rngState;
+	uint64_t index = 0;
+	std::chrono::steady_clock::time_point start;
+};
@@ -0,0 +1,168 @@
+#include "Trace.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+static const uint64_t CAPACITY = 1 << 16;	// Events per thread
+
+// Fields are atomics so a TraceWrite running on another thread never reads a
+// torn value, only possibly an overwritten event, which it then throws away
+struct TraceEvent
+{
+	std::atomic<const char*> name;
+	std::atomic<int64_t> start;	// Nanoseconds since the trace epoch
+	std::atomic<int64_t> end;
+};
+
+struct TraceBuffer
+{
+	std::string name;
+	int id = 0;
+	std::atomic<uint64_t> head { 0 };	// Number of events ever recorded
+	std::unique_ptr<TraceEvent[]> events { new TraceEvent[CAPACITY] };
+};
+
+static std::atomic<bool> enabled { false };
+static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+// Buffers are never freed, a thread that exited still shows up in the trace
+static std::mutex registryMutex;
+static std::vector<std::unique_ptr<TraceBuffer>> registry;
+static thread_local TraceBuffer* localBuffer = nullptr;
+
+// Until the thread records its first event, which may be never
+static thread_local std::string localName;
+
+static TraceBuffer& LocalBuffer()
+{
+	if(!localBuffer)
+	{
+		std::lock_guard<std::mutex> lock(registryMutex);
+		registry.emplace_back(new TraceBuffer());
+		localBuffer = registry.back().get();
+		localBuffer->id = (int)registry.size();
+		localBuffer->name = localName.empty() ? "thread " + std::to_string(localBuffer->id) : localName;
+	}
+	return *localBuffer;
+}
+
+static int64_t Nanoseconds(std::chrono::steady_clock::time_point t)
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(t - epoch).count();
+}
+
+// Names are free text, quotes and all
+static std::string JsonEscape(const char* s)
+{
+	std::string escaped;
+	for(; *s; s++)
+	{
+		if(*s == '"' || *s == '\\')
+		{
+			escaped += '\\';
+			escaped += *s;
+		}
+		else if((unsigned char)*s < 0x20)
+		{
+			char code[8];
+			snprintf(code, sizeof(code), "\\u%04x", (unsigned)*s);
+			escaped += code;
+		}
+		else
+			escaped += *s;
+	}
+	return escaped;
+}
+
+void TraceEnable(bool enable)
+{
+	enabled.store(enable, std::memory_order_relaxed);
+}
+
+bool TraceEnabled()
+{
+	return enabled.load(std::memory_order_relaxed);
+}
+
+void TraceSetThreadName(const char* name)
+{
+	// A thread only gets a buffer once it records something
+	localName = name;
+	if(localBuffer)
+	{
+		std::lock_guard<std::mutex> lock(registryMutex);
+		localBuffer->name = name;
+	}
+}
+
+void TraceRecord(const char* name, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end)
+{
+	if(!localBuffer && !TraceEnabled())
+		return;
+
+	TraceBuffer& buffer = LocalBuffer();
+	uint64_t head = buffer.head.load(std::memory_order_relaxed);
+	TraceEvent& e = buffer.events[head % CAPACITY];
+	e.name.store(name, std::memory_order_relaxed);
+	e.start.store(Nanoseconds(start), std::memory_order_relaxed);
+	e.end.store(Nanoseconds(end), std::memory_order_relaxed);
+	buffer.head.store(head + 1, std::memory_order_release);
+}
+
+bool TraceWrite(const char* path, double seconds)
+{
+	FILE* file = fopen(path, "w");
+	if(!file)
+	{
+		printf("Could not create %s\n", path);
+		return false;
+	}
+
+	int64_t since = Nanoseconds(std::chrono::steady_clock::now()) - (int64_t)(seconds * 1e9);
+
+	std::lock_guard<std::mutex> lock(registryMutex);
+	fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"camera-trail\"}}");
+
+	for(const std::unique_ptr<TraceBuffer>& buffer : registry)
+	{
+		fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}", buffer->id, JsonEscape(buffer->name.c_str()).c_str());
+
+		// Copy out what is there, then drop whatever the owner overwrote meanwhile,
+		// the event it may be writing right now included
+		uint64_t head = buffer->head.load(std::memory_order_acquire);
+		uint64_t first = head > CAPACITY ? head - CAPACITY : 0;
+		struct Copy { const char* name; int64_t start; int64_t end; };
+		std::vector<Copy> copies;
+		copies.reserve((size_t)(head - first));
+		for(uint64_t i = first; i < head; i++)
+		{
+			const TraceEvent& e = buffer->events[i % CAPACITY];
+			copies.push_back({ e.name.load(std::memory_order_relaxed), e.start.load(std::memory_order_relaxed), e.end.load(std::memory_order_relaxed) });
+		}
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+		uint64_t newHead = buffer->head.load(std::memory_order_relaxed);
+		uint64_t valid = newHead + 1 > CAPACITY ? newHead + 1 - CAPACITY : 0;
+
+		for(uint64_t i = std::max(first, valid); i < head; i++)
+		{
+			const Copy& c = copies[(size_t)(i - first)];
+			if(c.start < since)
+				continue;
+
+			fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+				JsonEscape(c.name).c_str(), buffer->id, c.start / 1000.0, (c.end - c.start) / 1000.0);
+		}
+	}
+
+	fprintf(file, "\n]}\n");
+	bool ok = ferror(file) == 0;
+	fclose(file);
+	return ok;
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <chrono>
+
+// Timeline of what every thread did, in the trace event format that Perfetto and
+// chrome://tracing load. Each thread records into its own fixed-size ring
+// buffer without locks, so only the newest events are kept; nothing is
+// formatted until TraceWrite is called.
+
+void TraceEnable(bool enable);
+bool TraceEnabled();
+
+// Name shown for the calling thread
+void TraceSetThreadName(const char* name);
+
+// Records a finished span on the calling thread. name must be a string literal
+// (or otherwise outlive the trace).
+void TraceRecord(const char* name, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end);
+
+// Writes the events of the last few seconds as JSON. Safe to call while other
+// threads keep recording.
+bool TraceWrite(const char* path, double seconds);
+
+// Records the time until it goes out of scope
+class TraceScope
+{
+public:
+	explicit TraceScope(const char* name)
+		: name(name), enabled(TraceEnabled())
+	{
+		if(enabled)
+			start = std::chrono::steady_clock::now();
+	}
+
+	~TraceScope()
+	{
+		if(enabled)
+			TraceRecord(name, start, std::chrono::steady_clock::now());
+	}
+
+private:
+	const char* name;
+	bool enabled;
+	std::chrono::steady_clock::time_point start;
+};
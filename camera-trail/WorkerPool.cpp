@@ -0,0 +1,92 @@
+#include "WorkerPool.hpp"
+#include "Trace.hpp"
+#include <algorithm>
+#include <string>
+
+WorkerPool::WorkerPool(int numThreads)
+{
+	if(numThreads <= 0)
+		numThreads = std::max((int)std::thread::hardware_concurrency(), 1);
+
+	for(int i = 1; i < numThreads; i++)
+		workers.emplace_back(&WorkerPool::WorkerLoop, this, i);
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		quit = true;
+	}
+	wake.notify_all();
+
+	for(std::thread& worker : workers)
+		worker.join();
+}
+
+void WorkerPool::Run(int numTasks, const std::function<void(int)>& task, const char* name)
+{
+	if(workers.empty() || numTasks <= 1)
+	{
+		for(int i = 0; i < numTasks; i++)
+		{
+			TraceScope scope(name);
+			task(i);
+		}
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		job = &task;
+		jobName = name;
+		this->numTasks = numTasks;
+		nextTask.store(0, std::memory_order_relaxed);
+		busyWorkers = (int)workers.size();
+		batch++;
+	}
+	wake.notify_all();
+
+	RunTasks();
+
+	// The task is only borrowed, nobody may still be inside it when Run returns
+	std::unique_lock<std::mutex> lock(mutex);
+	finished.wait(lock, [this] { return busyWorkers == 0; });
+	job = nullptr;
+}
+
+void WorkerPool::RunTasks()
+{
+	for(;;)
+	{
+		int i = nextTask.fetch_add(1, std::memory_order_relaxed);
+		if(i >= numTasks)
+			break;
+
+		TraceScope scope(jobName);
+		(*job)(i);
+	}
+}
+
+void WorkerPool::WorkerLoop(int index)
+{
+	TraceSetThreadName(("worker " + std::to_string(index)).c_str());
+
+	uint64_t seen = 0;
+	for(;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [&] { return quit || batch != seen; });
+			if(quit)
+				return;
+			seen = batch;
+		}
+
+		RunTasks();
+
+		std::lock_guard<std::mutex> lock(mutex);
+		if(--busyWorkers == 0)
+			finished.notify_one();
+	}
+}
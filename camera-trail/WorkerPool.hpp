@@ -0,0 +1,43 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Threads that are started once and then run small batches of tasks every
+// frame. The thread calling Run() works on the batch too, so a pool of one
+// thread has no workers at all and runs everything inline.
+class WorkerPool
+{
+public:
+	// 0 means one thread per hardware thread
+	explicit WorkerPool(int numThreads = 0);
+	~WorkerPool();
+
+	int NumThreads() const { return (int)workers.size() + 1; }
+
+	// Calls task(0) ... task(numTasks - 1), spread over all threads, and returns
+	// once every call has returned. Tasks are handed out in order as threads
+	// become free, so more tasks than threads evens out the load. Every call
+	// shows up in the trace as name, which must be a string literal.
+	void Run(int numTasks, const std::function<void(int)>& task, const char* name = "task");
+
+private:
+	void WorkerLoop(int index);
+	void RunTasks();
+
+	std::vector<std::thread> workers;
+
+	std::mutex mutex;
+	std::condition_variable wake;	// A new batch was posted, or the pool is shutting down
+	std::condition_variable finished;	// The last worker left the batch
+	const std::function<void(int)>* job = nullptr;
+	const char* jobName = nullptr;
+	int numTasks = 0;
+	std::atomic<int> nextTask { 0 };
+	int busyWorkers = 0;
+	uint64_t batch = 0;
+	bool quit = false;
+};
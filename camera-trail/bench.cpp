@@ -0,0 +1,904 @@
+// Headless benchmark of the per-frame work main() does, without a window or a
+// camera. Runs every DrawMode over synthetic or recorded frames for each
+// requested resolution and cell size, and reports how long every stage took.
+//
+// camera-trail-bench [--replay <file>] [--frames N] [--warmup N]
+//                    [--resolutions 1280x720,1920x1080] [--cell-sizes 1,5,10]
+//                    [--seed N] [--blobs N] [--no-trail] [--trace <file>]
+//                    [--isa scalar|sse2|avx2] [--self-test] [--threads 1,2,4,8]
+//                    [--layered] [--camera full|half-rate|decimated|off]
+//                    [--roi] [--full-scan N] [--min-lit N] [--life-isa scalar|avx2|avx512]
+//                    [--life-engine packed|sparse|hashlife] [--fast-forward N]
+//                    [--boundary torus|dead|mirror]
+//
+// camera-trail-bench --life-sizes 256x145,1280x720,8192x8192 [--threads 1,2,4,8] [--fast-forward N]
+//                    [--boundary torus|dead|mirror] [--life-soup N]
+// only steps Game of Life on random grids of those sizes, with every Life kernel, sparse and HashLife.
+// With --life-soup only an NxN square in the middle starts out alive.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "BitGrid.hpp"
+#include "BlobLabeler.hpp"
+#include "Canvas.hpp"
+#include "CellularAutomata.hpp"
+#include "HashLife.hpp"
+#include "ReplaySource.hpp"
+#include "SparseLife.hpp"
+#include "SyntheticSource.hpp"
+#include "Trace.hpp"
+
+struct Stage
+{
+	const char* name;
+	std::vector<double> samples;	// Milliseconds, one per frame
+};
+
+struct Resolution
+{
+	int width;
+	int height;
+};
+
+static const char* DrawModeName(DrawMode mode)
+{
+	switch(mode)
+	{
+	case DrawMode::NONE: return "NONE";
+	case DrawMode::NORMAL: return "NORMAL";
+	case DrawMode::RAINBOW: return "RAINBOW";
+	case DrawMode::GAME_OF_LIFE: return "GAME_OF_LIFE";
+	case DrawMode::SAND: return "SAND";
+	case DrawMode::STROKE: return "STROKE";
+	}
+	return "?";
+}
+
+template<typename Function>
+static void Time(Stage& stage, Function function)
+{
+	auto start = std::chrono::steady_clock::now();
+	function();
+	auto end = std::chrono::steady_clock::now();
+	stage.samples.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+	if(TraceEnabled())
+		TraceRecord(stage.name, start, end);
+}
+
+static void Report(const std::vector<Stage>& stages)
+{
+	for(const Stage& stage : stages)
+	{
+		if(stage.samples.empty())
+			continue;
+
+		std::vector<double> sorted = stage.samples;
+		std::sort(sorted.begin(), sorted.end());
+
+		double sum = 0.0;
+		for(double s : sorted)
+			sum += s;
+
+		size_t n = sorted.size();
+		printf("  %-10s mean %8.3f  p50 %8.3f  p99 %8.3f  max %8.3f ms\n", stage.name,
+			sum / n, sorted[n / 2], sorted[std::min(n - 1, n * 99 / 100)], sorted[n - 1]);
+	}
+}
+
+// A third alive, the same cells every time. With a soupSize only that square
+// in the middle of the grid is, and everything around it is dead.
+static void FillSoup(BitGrid& grid, int soupSize)
+{
+	int top = 0;
+	int left = 0;
+	int bottom = grid.Rows();
+	int right = grid.Columns();
+	if(soupSize > 0)
+	{
+		top = std::max((grid.Rows() - soupSize) / 2, 0);
+		left = std::max((grid.Columns() - soupSize) / 2, 0);
+		bottom = std::min(top + soupSize, grid.Rows());
+		right = std::min(left + soupSize, grid.Columns());
+	}
+
+	uint32_t state = 12345;
+	for(int i = top; i < bottom; i++)
+	for(int j = left; j < right; j++)
+	{
+		state = state * 1664525 + 1013904223;
+		if((state >> 8) % 3 == 0)
+			grid.Set(i, j);
+	}
+}
+
+// Times steps until a second has gone by, and reports them with how many
+// cells a second that is and how that compares to the scalar kernel
+static void TimeLife(const char* name, const Resolution& size, uint64_t generationsPerStep, double& scalarTime, const std::function<void()>& step)
+{
+	Stage stage { name, {} };
+	double total = 0.0;
+	for(int steps = 0; total < 1.0 || steps < 5; steps++)
+	{
+		Time(stage, step);
+		total += stage.samples.back() / 1000.0;
+	}
+
+	// Per generation, a step of HashLife can be many
+	std::vector<double> sorted = stage.samples;
+	std::sort(sorted.begin(), sorted.end());
+	double median = sorted[sorted.size() / 2] / generationsPerStep;
+	if(scalarTime == 0.0)
+		scalarTime = median;
+
+	Report({ stage });
+	printf("  %-10s %.2f Gcells/s, %.1fx scalar\n", "", (double)size.width * size.height / median / 1e6, scalarTime / median);
+}
+
+// Steps a random grid of every size with every supported Life kernel, only
+// its active tiles with the best one, and HashLife fastForward at a time, for
+// at least a second each. HashLife has no edges, so it is not quite the same
+// Life, but it starts from the same cells.
+static void BenchmarkLife(const std::vector<Resolution>& sizes, const std::vector<int>& threadCounts, int soupSize, int fastForward, Boundary boundary)
+{
+	const LifeIsa isas[] = { LifeIsa::SCALAR, LifeIsa::AVX2, LifeIsa::AVX512 };
+	for(int numThreads : threadCounts)
+	for(const Resolution& size : sizes)
+	{
+		WorkerPool workers(numThreads);
+		printf("Life %dx%d, %d threads\n", size.width, size.height, numThreads);
+
+		double scalarTime = 0.0;
+		for(LifeIsa isa : isas)
+		{
+			if(!LifeIsaSupported(isa))
+				continue;
+
+			BitGrid grid;
+			BitGrid next;
+			grid.Resize(size.height, size.width);
+			next.Resize(size.height, size.width);
+			FillSoup(grid, soupSize);
+
+			LifeRowKernel kernel = GetLifeRowKernel(isa);
+			TimeLife(LifeIsaName(isa), size, 1, scalarTime, [&]
+			{
+				StepLife(grid, next, kernel, &workers, boundary);
+				grid.Swap(next);
+			});
+		}
+
+		BitGrid grid;
+		BitGrid next;
+		grid.Resize(size.height, size.width);
+		next.Resize(size.height, size.width);
+		FillSoup(grid, soupSize);
+		SparseLife sparse;
+		sparse.Resize(size.height, size.width);
+		LifeRowKernel kernel = GetLifeRowKernel(BestLifeIsa());
+		double activeTiles = 0.0;
+		int steps = 0;
+		TimeLife("sparse", size, 1, scalarTime, [&]
+		{
+			sparse.Step(grid, next, kernel, &workers, boundary);
+			grid.Swap(next);
+			activeTiles += sparse.ActiveTiles();
+			steps++;
+		});
+		printf("  %-10s %.1f of %d tiles active per step\n", "", activeTiles / steps, sparse.NumTiles());
+
+		// Single threaded whatever the pool
+		grid.Resize(size.height, size.width);
+		FillSoup(grid, soupSize);
+		HashLife universe;
+		universe.Write(grid);
+		TimeLife("hashlife", size, 1ull << fastForward, scalarTime, [&] { universe.Step(fastForward); });
+		printf("  %-10s %zu nodes, generation %llu\n", "", universe.NumNodes(), (unsigned long long)universe.Generation());
+	}
+}
+
+// xorshift32, so every self-test run checks the same cases
+static uint32_t NextRandom(uint32_t& state)
+{
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+// The packed grid with every supported kernel and the sparse engine against
+// IterateCellularAutomata, cell for cell over 300 generations with every
+// boundary. Now and then cells are set from outside, the way the bands do.
+static bool LifeEngineSelfTest()
+{
+	const Boundary boundaries[] = { Boundary::TORUS, Boundary::DEAD, Boundary::MIRROR };
+	const LifeIsa isas[] = { LifeIsa::SCALAR, LifeIsa::AVX2, LifeIsa::AVX512 };
+	const Resolution sizes[] = { { 1, 1 }, { 5, 3 }, { 63, 10 }, { 64, 17 }, { 65, 33 }, { 128, 7 }, { 256, 145 }, { 1000, 50 } };
+	WorkerPool workers(4);
+	DrawMode mode = DrawMode::GAME_OF_LIFE;
+
+	for(Boundary boundary : boundaries)
+	for(LifeIsa isa : isas)
+	for(const Resolution& size : sizes)
+	{
+		if(!LifeIsaSupported(isa))
+			continue;
+
+		const int rows = size.height;
+		const int columns = size.width;
+		BitGrid packed;
+		BitGrid packedNext;
+		BitGrid sparse;
+		BitGrid sparseNext;
+		packed.Resize(rows, columns);
+		packedNext.Resize(rows, columns);
+		sparse.Resize(rows, columns);
+		sparseNext.Resize(rows, columns);
+		SparseLife sparseLife;
+		sparseLife.Resize(rows, columns);
+		std::vector<bool> cells((size_t)rows * columns);
+
+		uint32_t state = (uint32_t)(rows * 1000 + columns);
+		auto set = [&](int i, int j)
+		{
+			packed.Set(i, j);
+			sparse.Set(i, j);
+			sparseLife.Touch(i, j);
+			cells[(size_t)i * columns + j] = true;
+		};
+		for(int i = 0; i < rows; i++)
+		for(int j = 0; j < columns; j++)
+		{
+			if(NextRandom(state) % 3 == 0)
+				set(i, j);
+		}
+
+		LifeRowKernel kernel = GetLifeRowKernel(isa);
+		for(int generation = 0; generation < 300; generation++)
+		{
+			if(generation % 37 == 5)
+			{
+				for(int k = 0; k < 5; k++)
+					set(NextRandom(state) % rows, NextRandom(state) % columns);
+			}
+
+			IterateCellularAutomata(cells, rows, columns, mode, boundary);
+			StepLife(packed, packedNext, kernel, generation % 2 ? &workers : nullptr, boundary);
+			packed.Swap(packedNext);
+			sparseLife.Step(sparse, sparseNext, kernel, generation % 2 ? nullptr : &workers, boundary);
+			sparse.Swap(sparseNext);
+
+			for(int i = 0; i < rows; i++)
+			for(int j = 0; j < columns; j++)
+			{
+				bool expected = cells[(size_t)i * columns + j];
+				if(packed.Get(i, j) != expected || sparse.Get(i, j) != expected)
+				{
+					printf("Life %dx%d with %s, %s boundary, differs at generation %d, cell %d,%d\n", columns, rows, LifeIsaName(isa),
+						boundary == Boundary::TORUS ? "torus" : boundary == Boundary::DEAD ? "dead" : "mirror", generation, i, j);
+					return false;
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+// HashLife against IterateCellularAutomata with a DEAD boundary, on a soup in
+// the middle of a grid so big nothing gets near its edges: 100 single
+// generations, then 10 jumps of 8. Once with the default node limit and once
+// with one small enough that squares are collected in the middle of a step.
+static bool HashLifeSelfTest()
+{
+	const int size = 256;
+	const int soupSize = 32;
+	const size_t maxNodes[] = { HashLife::DEFAULT_MAX_NODES, 2000 };
+	DrawMode mode = DrawMode::GAME_OF_LIFE;
+
+	for(size_t limit : maxNodes)
+	{
+		BitGrid grid;
+		grid.Resize(size, size);
+		std::vector<bool> cells((size_t)size * size);
+		uint32_t state = 7;
+		for(int i = (size - soupSize) / 2; i < (size + soupSize) / 2; i++)
+		for(int j = (size - soupSize) / 2; j < (size + soupSize) / 2; j++)
+		{
+			if(NextRandom(state) % 3 == 0)
+			{
+				grid.Set(i, j);
+				cells[(size_t)i * size + j] = true;
+			}
+		}
+
+		HashLife universe;
+		universe.SetMaxNodes(limit);
+		universe.Write(grid);
+		for(int step = 0; step < 110; step++)
+		{
+			int log2Generations = step < 100 ? 0 : 3;
+			universe.Step(log2Generations);
+			for(int k = 0; k < 1 << log2Generations; k++)
+				IterateCellularAutomata(cells, size, size, mode, Boundary::DEAD);
+
+			// Every cell of the universe has to be on the grid too
+			universe.Read(grid);
+			uint64_t population = 0;
+			for(int i = 0; i < size; i++)
+			for(int j = 0; j < size; j++)
+			{
+				bool expected = cells[(size_t)i * size + j];
+				population += expected;
+				if(grid.Get(i, j) != expected)
+				{
+					printf("HashLife differs at generation %llu, cell %d,%d\n", (unsigned long long)universe.Generation(), i, j);
+					return false;
+				}
+			}
+			if(universe.Population() != population)
+			{
+				printf("HashLife has %llu cells at generation %llu, expected %llu\n", (unsigned long long)universe.Population(),
+					(unsigned long long)universe.Generation(), (unsigned long long)population);
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+// BlobLabeler against a flood fill on random masks of random density, cut
+// into random bands that are fed in a random order
+static bool BlobLabelerSelfTest()
+{
+	uint32_t state = 3;
+	for(int round = 0; round < 3000; round++)
+	{
+		const int width = 1 + NextRandom(state) % 40;
+		const int height = 1 + NextRandom(state) % 40;
+		const uint32_t density = NextRandom(state) % 100;
+		std::vector<uint8_t> mask((size_t)width * height);
+		for(uint8_t& pixel : mask)
+			pixel = NextRandom(state) % 100 < density;
+
+		// Numbered in the order their first pixel comes up row by row, which is
+		// the order the labeler gives them in
+		struct Expected
+		{
+			int area;
+			int64_t sumX;
+			int64_t sumY;
+			int left;
+			int top;
+			int right;
+			int bottom;
+		};
+		std::vector<Expected> expected;
+		std::vector<uint8_t> seen(mask.size());
+		std::vector<int> stack;
+		for(int i = 0; i < height; i++)
+		for(int j = 0; j < width; j++)
+		{
+			if(!mask[(size_t)i * width + j] || seen[(size_t)i * width + j])
+				continue;
+
+			Expected blob = { 0, 0, 0, j, i, j, i };
+			seen[(size_t)i * width + j] = 1;
+			stack.push_back(i * width + j);
+			while(!stack.empty())
+			{
+				int x = stack.back() % width;
+				int y = stack.back() / width;
+				stack.pop_back();
+				blob.area++;
+				blob.sumX += x;
+				blob.sumY += y;
+				blob.left = std::min(blob.left, x);
+				blob.right = std::max(blob.right, x);
+				blob.top = std::min(blob.top, y);
+				blob.bottom = std::max(blob.bottom, y);
+				for(int dy = -1; dy <= 1; dy++)
+				for(int dx = -1; dx <= 1; dx++)
+				{
+					int nx = x + dx;
+					int ny = y + dy;
+					if(nx >= 0 && nx < width && ny >= 0 && ny < height && mask[(size_t)ny * width + nx] && !seen[(size_t)ny * width + nx])
+					{
+						seen[(size_t)ny * width + nx] = 1;
+						stack.push_back(ny * width + nx);
+					}
+				}
+			}
+			expected.push_back(blob);
+		}
+
+		std::vector<int> cuts { 0 };
+		while(cuts.back() < height)
+			cuts.push_back(std::min(height, cuts.back() + 1 + (int)(NextRandom(state) % 8)));
+		const int numBands = (int)cuts.size() - 1;
+		std::vector<int> order(numBands);
+		for(int b = 0; b < numBands; b++)
+			order[b] = b;
+		for(int b = numBands - 1; b > 0; b--)
+			std::swap(order[b], order[NextRandom(state) % (b + 1)]);
+
+		BlobLabeler labeler;
+		labeler.Begin(numBands);
+		std::vector<int> lit;
+		for(int b : order)
+		{
+			for(int i = cuts[b]; i < cuts[b + 1]; i++)
+			{
+				lit.clear();
+				for(int j = 0; j < width; j++)
+				{
+					if(mask[(size_t)i * width + j])
+						lit.push_back(j);
+				}
+				labeler.AddRow(b, i, lit.data(), (int)lit.size());
+			}
+		}
+		labeler.Finish();
+
+		const std::vector<Blob>& blobs = labeler.Blobs();
+		bool same = blobs.size() == expected.size();
+		for(size_t k = 0; same && k < blobs.size(); k++)
+		{
+			const Blob& blob = blobs[k];
+			const Expected& e = expected[k];
+			same = blob.area == e.area && blob.left == e.left && blob.top == e.top && blob.right == e.right && blob.bottom == e.bottom &&
+				std::fabs(blob.x - (double)e.sumX / e.area) < 1e-3 && std::fabs(blob.y - (double)e.sumY / e.area) < 1e-3;
+		}
+		if(!same)
+		{
+			printf("Blobs of a %dx%d mask in %d bands differ from a flood fill\n", width, height, numBands);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// LAYERED against COMBINED on the same frames, pixel for pixel, through mode
+// switches, clears, the trail going off and on and a new fade curve: the
+// camera has to come out the same, and the drawing with the alpha COMBINED
+// puts over it
+static bool LayeredSelfTest()
+{
+	const int width = 320;
+	const int height = 180;
+	SyntheticParams params;
+	params.width = width;
+	params.height = height;
+	params.fps = 0.0;
+	params.blobs = 3;
+	SyntheticSource combinedSource(params);
+	SyntheticSource layeredSource(params);
+	std::vector<uint32_t> scratch((size_t)width * height);
+	std::vector<uint8_t> drawing((size_t)width * height * 4);
+
+	WorkerPool workers(3);
+	Canvas combined(width, height, 5);
+	Canvas layered(width, height, 5);
+	layered.SetCompositing(Compositing::LAYERED);
+	layered.SetWorkerPool(&workers);
+
+	for(int f = 0; f < 600; f++)
+	{
+		DrawMode mode = f < 100 ? DrawMode::STROKE : f < 200 ? DrawMode::NORMAL : f < 300 ? DrawMode::SAND :
+			f < 400 ? DrawMode::NONE : f < 550 ? DrawMode::STROKE : DrawMode::NORMAL;
+		bool trail = f < 420 || f >= 470;
+		if(f == 350 || f == 450 || f == 451)
+		{
+			combined.Clear(trail);
+			layered.Clear(trail);
+		}
+		if(f == 500)
+		{
+			combined.SetFadeCurve(FadeCurve::EXPONENTIAL);
+			layered.SetFadeCurve(FadeCurve::EXPONENTIAL);
+		}
+
+		Frame frame;
+		combinedSource.NextFrame(frame, scratch.data());
+		combined.ProcessFrame(frame.pixels, frame.timestamp, mode, trail);
+		layeredSource.NextFrame(frame, scratch.data());
+		layered.ProcessFrame(frame.pixels, frame.timestamp, mode, trail);
+		layered.CopyDrawing(drawing.data());
+
+		for(size_t i = 0; i < (size_t)width * height; i++)
+		{
+			const uint8_t* expected = combined.Pixels() + i * 4;
+			const uint8_t* camera = layered.Pixels() + i * 4;
+			if(camera[0] != expected[0] || camera[1] != expected[1] || camera[2] != expected[2] || camera[3] != 255 ||
+				drawing[i * 4 + 3] != 255 - expected[3])
+			{
+				printf("LAYERED differs from COMBINED at frame %d, pixel %zu\n", f, i);
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+// Parses "a,b,c" with the given function for every element
+template<typename T, typename Parse>
+static std::vector<T> ParseList(const char* list, Parse parse)
+{
+	std::vector<T> result;
+	const char* p = list;
+	while(*p)
+	{
+		const char* end = strchr(p, ',');
+		std::string item = end ? std::string(p, end) : std::string(p);
+		result.push_back(parse(item.c_str()));
+		if(!end)
+			break;
+		p = end + 1;
+	}
+	return result;
+}
+
+int main(int argc, char** argv)
+{
+	const char* replayPath = nullptr;
+	const char* tracePath = nullptr;
+	int numFrames = 300;
+	int warmup = 30;
+	bool trail = true;
+	SyntheticParams syntheticParams;
+	syntheticParams.fps = 0.0;
+	std::vector<Resolution> resolutions { { 1280, 720 } };
+	std::vector<int> cellSizes { 5 };
+	KernelIsa isa = BestKernelIsa();
+	std::vector<int> threadCounts { 1 };
+	bool layered = false;
+	CameraLayer cameraLayer = CameraLayer::FULL;
+	bool roi = false;
+	int fullScanInterval = Canvas::FULL_SCAN_INTERVAL;
+	int minLitPerCell = 1;
+	LifeIsa lifeIsa = BestLifeIsa();
+	std::vector<Resolution> lifeSizes;
+	int soupSize = 0;	// The whole grid
+	LifeEngine lifeEngine = LifeEngine::PACKED;
+	int fastForward = 0;
+	Boundary boundary = Boundary::TORUS;
+
+	for(int i = 1; i < argc; i++)
+	{
+		if(strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+			replayPath = argv[++i];
+		else if(strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+			numFrames = std::max(atoi(argv[++i]), 1);
+		else if(strcmp(argv[i], "--warmup") == 0 && i + 1 < argc)
+			warmup = std::max(atoi(argv[++i]), 0);
+		else if(strcmp(argv[i], "--resolutions") == 0 && i + 1 < argc)
+		{
+			resolutions = ParseList<Resolution>(argv[++i], [](const char* s)
+			{
+				Resolution r { 0, 0 };
+				sscanf(s, "%dx%d", &r.width, &r.height);
+				return r;
+			});
+		}
+		else if(strcmp(argv[i], "--cell-sizes") == 0 && i + 1 < argc)
+			cellSizes = ParseList<int>(argv[++i], [](const char* s) { return atoi(s); });
+		else if(strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+			syntheticParams.seed = (uint32_t)strtoul(argv[++i], nullptr, 10);
+		else if(strcmp(argv[i], "--blobs") == 0 && i + 1 < argc)
+			syntheticParams.blobs = atoi(argv[++i]);
+		else if(strcmp(argv[i], "--no-trail") == 0)
+			trail = false;
+		else if(strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+			tracePath = argv[++i];
+		else if(strcmp(argv[i], "--layered") == 0)
+			layered = true;
+		else if(strcmp(argv[i], "--camera") == 0 && i + 1 < argc)
+		{
+			const char* layer = argv[++i];
+			if(strcmp(layer, "full") == 0)
+				cameraLayer = CameraLayer::FULL;
+			else if(strcmp(layer, "half-rate") == 0)
+				cameraLayer = CameraLayer::HALF_RATE;
+			else if(strcmp(layer, "decimated") == 0)
+				cameraLayer = CameraLayer::DECIMATED;
+			else if(strcmp(layer, "off") == 0)
+				cameraLayer = CameraLayer::DISABLED;
+			else
+			{
+				printf("Unknown camera layer: %s\n", layer);
+				return -1;
+			}
+			layered = layered || cameraLayer != CameraLayer::FULL;
+		}
+		else if(strcmp(argv[i], "--roi") == 0)
+			roi = true;
+		else if(strcmp(argv[i], "--full-scan") == 0 && i + 1 < argc)
+			fullScanInterval = std::max(atoi(argv[++i]), 1);
+		else if(strcmp(argv[i], "--min-lit") == 0 && i + 1 < argc)
+			minLitPerCell = std::max(atoi(argv[++i]), 1);
+		else if(strcmp(argv[i], "--life-sizes") == 0 && i + 1 < argc)
+		{
+			lifeSizes = ParseList<Resolution>(argv[++i], [](const char* s)
+			{
+				Resolution r { 0, 0 };
+				sscanf(s, "%dx%d", &r.width, &r.height);
+				return r;
+			});
+		}
+		else if(strcmp(argv[i], "--life-soup") == 0 && i + 1 < argc)
+			soupSize = std::max(atoi(argv[++i]), 0);
+		else if(strcmp(argv[i], "--life-engine") == 0 && i + 1 < argc)
+		{
+			const char* engine = argv[++i];
+			if(strcmp(engine, "packed") == 0)
+				lifeEngine = LifeEngine::PACKED;
+			else if(strcmp(engine, "sparse") == 0)
+				lifeEngine = LifeEngine::SPARSE;
+			else if(strcmp(engine, "hashlife") == 0)
+				lifeEngine = LifeEngine::HASHLIFE;
+			else
+			{
+				printf("Unknown Life engine: %s\n", engine);
+				return -1;
+			}
+		}
+		else if(strcmp(argv[i], "--fast-forward") == 0 && i + 1 < argc)
+			fastForward = std::min(std::max(atoi(argv[++i]), 0), (int)HashLife::MAX_STEP_LOG);
+		else if(strcmp(argv[i], "--boundary") == 0 && i + 1 < argc)
+		{
+			const char* name = argv[++i];
+			if(strcmp(name, "torus") == 0)
+				boundary = Boundary::TORUS;
+			else if(strcmp(name, "dead") == 0)
+				boundary = Boundary::DEAD;
+			else if(strcmp(name, "mirror") == 0)
+				boundary = Boundary::MIRROR;
+			else
+			{
+				printf("Unknown boundary: %s\n", name);
+				return -1;
+			}
+		}
+		else if(strcmp(argv[i], "--life-isa") == 0 && i + 1 < argc)
+		{
+			const char* name = argv[++i];
+			const LifeIsa isas[] = { LifeIsa::SCALAR, LifeIsa::AVX2, LifeIsa::AVX512 };
+			bool found = false;
+			for(LifeIsa candidate : isas)
+			{
+				if(strcmp(name, LifeIsaName(candidate)) == 0)
+				{
+					lifeIsa = candidate;
+					found = true;
+				}
+			}
+			if(!found || !LifeIsaSupported(lifeIsa))
+			{
+				printf("Unsupported Life kernel: %s\n", name);
+				return -1;
+			}
+		}
+		else if(strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+			threadCounts = ParseList<int>(argv[++i], [](const char* s) { return atoi(s); });
+		else if(strcmp(argv[i], "--isa") == 0 && i + 1 < argc)
+		{
+			const char* name = argv[++i];
+			const KernelIsa isas[] = { KernelIsa::SCALAR, KernelIsa::SSE2, KernelIsa::AVX2 };
+			bool found = false;
+			for(KernelIsa candidate : isas)
+			{
+				if(strcmp(name, KernelIsaName(candidate)) == 0)
+				{
+					isa = candidate;
+					found = true;
+				}
+			}
+			if(!found || !KernelIsaSupported(isa))
+			{
+				printf("Unsupported kernel: %s\n", name);
+				return -1;
+			}
+		}
+		else if(strcmp(argv[i], "--self-test") == 0)
+		{
+			bool pixelsPassed = PixelKernelSelfTest();
+			printf("Pixel kernel self-test %s\n", pixelsPassed ? "passed" : "FAILED");
+			bool lifePassed = LifeKernelSelfTest();
+			printf("Life kernel self-test %s\n", lifePassed ? "passed" : "FAILED");
+			bool enginesPassed = LifeEngineSelfTest();
+			printf("Life engine self-test %s\n", enginesPassed ? "passed" : "FAILED");
+			bool hashLifePassed = HashLifeSelfTest();
+			printf("HashLife self-test %s\n", hashLifePassed ? "passed" : "FAILED");
+			bool blobsPassed = BlobLabelerSelfTest();
+			printf("Blob labeler self-test %s\n", blobsPassed ? "passed" : "FAILED");
+			bool layeredPassed = LayeredSelfTest();
+			printf("Layered compositing self-test %s\n", layeredPassed ? "passed" : "FAILED");
+			return pixelsPassed && lifePassed && enginesPassed && hashLifePassed && blobsPassed && layeredPassed ? 0 : -1;
+		}
+		else
+		{
+			printf("Unknown argument: %s\n", argv[i]);
+			return -1;
+		}
+	}
+
+	// A recording comes with its own resolution
+	if(replayPath)
+	{
+		ReplaySource probe((ReplayParams()));
+		if(!probe.Open(replayPath))
+			return -1;
+		resolutions = { { probe.Width(), probe.Height() } };
+	}
+
+	for(const Resolution& resolution : resolutions)
+	{
+		if(resolution.width <= 0 || resolution.height <= 0)
+		{
+			printf("Invalid resolution\n");
+			return -1;
+		}
+	}
+
+	for(int cellSize : cellSizes)
+	{
+		if(cellSize <= 0)
+		{
+			printf("Invalid cell size\n");
+			return -1;
+		}
+	}
+
+	for(int numThreads : threadCounts)
+	{
+		if(numThreads <= 0)
+		{
+			printf("Invalid thread count\n");
+			return -1;
+		}
+	}
+
+	if(tracePath)
+	{
+		TraceEnable(true);
+		TraceSetThreadName("bench");
+	}
+
+	for(const Resolution& size : lifeSizes)
+	{
+		if(size.width <= 0 || size.height <= 0)
+		{
+			printf("Invalid Life grid size\n");
+			return -1;
+		}
+	}
+
+	if(!lifeSizes.empty())
+	{
+		BenchmarkLife(lifeSizes, threadCounts, soupSize, fastForward, boundary);
+		if(tracePath && !TraceWrite(tracePath, 1e9))
+			return -1;
+		return 0;
+	}
+
+	printf("Pixel kernel: %s\n", KernelIsaName(isa));
+	printf("Life kernel: %s\n", LifeIsaName(lifeIsa));
+	printf("Life engine: %s\n", lifeEngine == LifeEngine::HASHLIFE ? "hashlife" : lifeEngine == LifeEngine::SPARSE ? "sparse" : "packed");
+	printf("Boundary: %s\n", boundary == Boundary::TORUS ? "torus" : boundary == Boundary::DEAD ? "dead" : "mirror");
+
+	const DrawMode modes[] = { DrawMode::NONE, DrawMode::NORMAL, DrawMode::RAINBOW, DrawMode::GAME_OF_LIFE, DrawMode::SAND, DrawMode::STROKE };
+	for(int numThreads : threadCounts)
+	for(const Resolution& resolution : resolutions)
+	for(int cellSize : cellSizes)
+	for(DrawMode mode : modes)
+	{
+		// Every run sees the same frames from the start
+		std::unique_ptr<FrameSource> source;
+		if(replayPath)
+		{
+			ReplayParams replayParams;
+			replayParams.pacing = ReplayPacing::FAST;
+			replayParams.loop = true;
+			ReplaySource* replay = new ReplaySource(replayParams);
+			source.reset(replay);
+			if(!replay->Open(replayPath))
+				return -1;
+		}
+		else
+		{
+			syntheticParams.width = resolution.width;
+			syntheticParams.height = resolution.height;
+			source.reset(new SyntheticSource(syntheticParams));
+		}
+
+		WorkerPool workers(numThreads);
+		Canvas canvas(resolution.width, resolution.height, cellSize);
+		canvas.SetKernelIsa(isa);
+		canvas.SetLifeIsa(lifeIsa);
+		canvas.SetWorkerPool(&workers);
+		if(layered)
+			canvas.SetCompositing(Compositing::LAYERED);
+		canvas.SetCameraLayer(cameraLayer);
+		canvas.SetRegionOfInterest(roi, fullScanInterval);
+		canvas.SetMinLitPerCell(minLitPerCell);
+		canvas.SetLifeEngine(lifeEngine);
+		canvas.SetFastForward(fastForward);
+		canvas.SetBoundary(boundary);
+		std::vector<uint32_t> scratch((size_t)resolution.width * resolution.height);
+
+		std::vector<Stage> stages { { "pixels", {} }, { "vertices", {} }, { "automaton", {} } };
+		std::vector<double> frameTimes;
+		uint64_t redrawnTiles = 0;
+		uint64_t uploadBytes = 0;
+		uint64_t numBlobs = 0;
+		double thresholded = 0.0;
+		uint64_t activeTiles = 0;
+		for(int i = 0; i < warmup + numFrames; i++)
+		{
+			if(i == warmup)
+			{
+				for(Stage& stage : stages)
+					stage.samples.clear();
+			}
+
+			Frame frame;
+			if(!source->NextFrame(frame, scratch.data()))
+			{
+				printf("Ran out of frames\n");
+				return -1;
+			}
+
+			auto start = std::chrono::steady_clock::now();
+			Time(stages[0], [&] { canvas.ProcessFrame(frame.pixels, frame.timestamp, mode, trail); });
+			if(mode == DrawMode::GAME_OF_LIFE || mode == DrawMode::SAND)
+			{
+				Time(stages[1], [&] { canvas.BuildGridVertices(); });
+				Time(stages[2], [&] { canvas.StepAutomaton(mode); });
+			}
+
+			if(i >= warmup)
+			{
+				frameTimes.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+				redrawnTiles += canvas.RedrawnTiles();
+				numBlobs += canvas.Blobs().size();
+				thresholded += canvas.ThresholdedFraction();
+				activeTiles += canvas.ActiveLifeTiles();
+				if(canvas.CameraChanged())
+					uploadBytes += (uint64_t)canvas.CameraWidth() * canvas.CameraHeight() * 4;
+				if(layered)
+					uploadBytes += (uint64_t)canvas.RedrawnTiles() * Canvas::TILE_SIZE * Canvas::TILE_SIZE * 4;
+			}
+		}
+
+		double total = 0.0;
+		for(double t : frameTimes)
+			total += t;
+
+		printf("%dx%d cell %d %s, %d threads: %.1f fps\n", resolution.width, resolution.height, cellSize, DrawModeName(mode), numThreads, frameTimes.size() / total);
+		Report(stages);
+		if(layered)
+			printf("  %-10s %.1f of %d redrawn per frame\n", "tiles", (double)redrawnTiles / frameTimes.size(), canvas.NumTiles());
+		printf("  %-10s %.0f KB per frame\n", "upload", uploadBytes / 1024.0 / frameTimes.size());
+		printf("  %-10s %.1f per frame\n", "blobs", (double)numBlobs / frameTimes.size());
+		printf("  %-10s %.1f%% of pixels per frame\n", "threshold", thresholded * 100.0 / frameTimes.size());
+		if(mode == DrawMode::GAME_OF_LIFE && lifeEngine == LifeEngine::SPARSE)
+			printf("  %-10s %.1f of %d active per frame\n", "life tiles", (double)activeTiles / frameTimes.size(), canvas.NumLifeTiles());
+		if(mode == DrawMode::GAME_OF_LIFE && lifeEngine == LifeEngine::HASHLIFE)
+			printf("  %-10s %zu nodes, generation %llu\n", "universe", canvas.Universe().NumNodes(), (unsigned long long)canvas.Universe().Generation());
+	}
+
+	// Everything the ring buffers still hold
+	if(tracePath && !TraceWrite(tracePath, 1e9))
+		return -1;
+
+	return 0;
+}
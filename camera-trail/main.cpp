@@ -1,137 +1,266 @@
-#include <escapi.h>
+#include <algorithm>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
 #include <vector>
 #include <SFML/Graphics.hpp>
-
-enum class DrawMode
-{
-	NONE,
-	NORMAL,
-	RAINBOW,
-	GAME_OF_LIFE,
-	SAND
-};
-
-void IterateCellularAutomata(std::vector<bool>& grid, int rows, int columns, DrawMode& mode)
+#include "Canvas.hpp"
+#include "CaptureRing.hpp"
+#include "EscapiSource.hpp"
+#include "FrameProfiler.hpp"
+#include "Hud.hpp"
+#include "ReplaySource.hpp"
+#include "SessionFile.hpp"
+#include "SessionRecorder.hpp"
+#include "StreamingTexture.hpp"
+#include "SyntheticSource.hpp"
+#include "Trace.hpp"
+
+int main(int argc, char** argv)
 {
-	std::vector<bool> tmp = grid;
-	for(int i = 0; i < rows; i++)
-	for(int j = 0; j < columns; j++)
+	const int WIDTH = 1280;
+	const int HEIGHT = 720;
+	bool trail = true;	// Drawing or trail
+
+	// Frames come from the first camera (0), unless a generated scene or a recording is asked for
+	bool synthetic = false;
+	SyntheticParams syntheticParams;
+	syntheticParams.width = WIDTH;
+	syntheticParams.height = HEIGHT;
+	const char* replayPath = nullptr;
+	ReplayParams replayParams;
+	const char* recordPath = nullptr;
+	const char* recordRawPath = nullptr;
+	double traceSeconds = 10.0;
+	int numThreads = 0;	// One per hardware thread
+	FadeCurve fadeCurve = FadeCurve::LINEAR;
+	bool layered = false;
+	CameraLayer cameraLayer = CameraLayer::FULL;
+	bool pixelBuffers = true;
+	int maxFrames = 0;	// Run until the window is closed
+	bool roi = false;
+	int fullScanInterval = Canvas::FULL_SCAN_INTERVAL;
+	int minLitPerCell = 1;
+	LifeEngine lifeEngine = LifeEngine::PACKED;
+	Boundary boundary = Boundary::TORUS;
+	int fastForward = 0;	// 2^N generations a frame with HashLife
+	for(int i = 1; i < argc; i++)
 	{
-		int index = i * columns + j;
-		
-		if(mode == DrawMode::GAME_OF_LIFE)
+		if(strcmp(argv[i], "--synthetic") == 0)
+			synthetic = true;
+		else if(strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+			syntheticParams.seed = (uint32_t)strtoul(argv[++i], nullptr, 10);
+		else if(strcmp(argv[i], "--blobs") == 0 && i + 1 < argc)
+			syntheticParams.blobs = atoi(argv[++i]);
+		else if(strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+			replayPath = argv[++i];
+		else if(strcmp(argv[i], "--fast") == 0)
+			replayParams.pacing = ReplayPacing::FAST;
+		else if(strcmp(argv[i], "--loop") == 0)
+			replayParams.loop = true;
+		else if(strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+			recordPath = argv[++i];
+		else if(strcmp(argv[i], "--record-raw") == 0 && i + 1 < argc)
+			recordRawPath = argv[++i];
+		else if(strcmp(argv[i], "--trace") == 0)
+			TraceEnable(true);
+		else if(strcmp(argv[i], "--trace-seconds") == 0 && i + 1 < argc)
+			traceSeconds = atof(argv[++i]);
+		else if(strcmp(argv[i], "--fade") == 0 && i + 1 < argc)
 		{
-			int numNeighbors = 0;
-			bool neighbors[8] {0};
-
-			for(int k = -1; k <= 1; k++)
-			for(int l = -1; l <= 1; l++)
+			const char* curve = argv[++i];
+			if(strcmp(curve, "linear") == 0)
+				fadeCurve = FadeCurve::LINEAR;
+			else if(strcmp(curve, "exponential") == 0)
+				fadeCurve = FadeCurve::EXPONENTIAL;
+			else
 			{
-				// Wrap around
-				int neighborIndex = (i + k) * columns + (j + l);
-				if((k == 0 && l == 0) || neighborIndex < 0 || neighborIndex >= rows * columns)
-					continue;
-
-				if(grid[neighborIndex])
-					neighbors[numNeighbors++] = true;
+				printf("Unknown fade curve: %s\n", curve);
+				return -1;
 			}
-			if(grid[index] && (numNeighbors == 2 || numNeighbors == 3))
-				continue;
-			else if(!grid[index] && numNeighbors == 3)
-				tmp[index] = true;
-			else
-				tmp[index] = false;
 		}
-		else if(mode == DrawMode::SAND)
+		else if(strcmp(argv[i], "--layered") == 0)
+			layered = true;
+		else if(strcmp(argv[i], "--camera") == 0 && i + 1 < argc)
 		{
-			// Count neighbors
-			int neighbors[3] {0};
-			int numNeighbors = 0;
-
-			for(int l = -1; l <= 1; l++)
+			// Anything less than the full camera needs the drawing in a layer of its own
+			const char* layer = argv[++i];
+			if(strcmp(layer, "full") == 0)
+				cameraLayer = CameraLayer::FULL;
+			else if(strcmp(layer, "half-rate") == 0)
+				cameraLayer = CameraLayer::HALF_RATE;
+			else if(strcmp(layer, "decimated") == 0)
+				cameraLayer = CameraLayer::DECIMATED;
+			else if(strcmp(layer, "off") == 0)
+				cameraLayer = CameraLayer::DISABLED;
+			else
 			{
-				int neighborIndex = (i + 1) * columns + j + l;
-				if(neighborIndex < 0 || neighborIndex >= rows * columns)
-				{
-					neighbors[l + 1] = -1;
-					continue;
-				}
-
-				if(grid[neighborIndex])
-					neighbors[numNeighbors++] = 1;
+				printf("Unknown camera layer: %s\n", layer);
+				return -1;
 			}
-
-			if(!grid[index])
-				continue;
-
-			if(neighbors[1] == 0) // falling straight down
+			layered = layered || cameraLayer != CameraLayer::FULL;
+		}
+		else if(strcmp(argv[i], "--upload") == 0 && i + 1 < argc)
+		{
+			const char* upload = argv[++i];
+			if(strcmp(upload, "pbo") == 0)
+				pixelBuffers = true;
+			else if(strcmp(upload, "direct") == 0)
+				pixelBuffers = false;
+			else
 			{
-				tmp[index + columns] = true;
-				tmp[index] = false;
+				printf("Unknown upload path: %s\n", upload);
+				return -1;
 			}
-			else if(neighbors[0] == 0)	// falling to the left
+		}
+		else if(strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+			maxFrames = std::max(atoi(argv[++i]), 1);
+		else if(strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+			numThreads = std::max(atoi(argv[++i]), 1);
+		else if(strcmp(argv[i], "--roi") == 0)
+			roi = true;
+		else if(strcmp(argv[i], "--full-scan") == 0 && i + 1 < argc)
+			fullScanInterval = std::max(atoi(argv[++i]), 1);
+		else if(strcmp(argv[i], "--min-lit") == 0 && i + 1 < argc)
+			minLitPerCell = std::max(atoi(argv[++i]), 1);
+		else if(strcmp(argv[i], "--life-engine") == 0 && i + 1 < argc)
+		{
+			const char* engine = argv[++i];
+			if(strcmp(engine, "packed") == 0)
+				lifeEngine = LifeEngine::PACKED;
+			else if(strcmp(engine, "sparse") == 0)
+				lifeEngine = LifeEngine::SPARSE;
+			else if(strcmp(engine, "hashlife") == 0)
+				lifeEngine = LifeEngine::HASHLIFE;
+			else
 			{
-				tmp[index + columns - 1] = true;
-				tmp[index] = false;
+				printf("Unknown Life engine: %s\n", engine);
+				return -1;
 			}
-			else if(neighbors[2] == 0) // falling to the right
+		}
+		else if(strcmp(argv[i], "--fast-forward") == 0 && i + 1 < argc)
+			fastForward = atoi(argv[++i]);
+		else if(strcmp(argv[i], "--boundary") == 0 && i + 1 < argc)
+		{
+			const char* name = argv[++i];
+			if(strcmp(name, "torus") == 0)
+				boundary = Boundary::TORUS;
+			else if(strcmp(name, "dead") == 0)
+				boundary = Boundary::DEAD;
+			else if(strcmp(name, "mirror") == 0)
+				boundary = Boundary::MIRROR;
+			else
 			{
-				tmp[index + columns + 1] = true;
-				tmp[index] = false;
+				printf("Unknown boundary: %s\n", name);
+				return -1;
 			}
 		}
+		else
+		{
+			printf("Unknown argument: %s\n", argv[i]);
+			return -1;
+		}
 	}
 
-	grid = tmp;
-}
-
-int main()
-{
-	const int WIDTH = 1280;
-	const int HEIGHT = 720;
-	const int TRESHOLD = 255;
-	bool trail = true;	// Drawing or trail
-
-	// Create SFML window
-	sf::RenderWindow window(sf::VideoMode(WIDTH, HEIGHT), "Camera Trail (Stefan Ivanovski)");
-	window.setFramerateLimit(60);
+	std::unique_ptr<FrameSource> source;
+	if(replayPath)
+	{
+		ReplaySource* replay = new ReplaySource(replayParams);
+		source.reset(replay);
+		if(!replay->Open(replayPath))
+			return -1;
 
-	// Initialize ESCAPI 
-	int devices = setupESCAPI();
-	if(devices == 0)
+		if(replay->Width() != WIDTH || replay->Height() != HEIGHT)
+		{
+			printf("The recording is %dx%d, expected %dx%d\n", replay->Width(), replay->Height(), WIDTH, HEIGHT);
+			return -1;
+		}
+	}
+	else if(synthetic)
+		source.reset(new SyntheticSource(syntheticParams));
+	else
 	{
-		printf("No camera detected!\n");
-		return -1;
+		EscapiSource* camera = new EscapiSource(0, WIDTH, HEIGHT);
+		source.reset(camera);
+		if(!camera->Open())
+			return -1;
 	}
 
-	// Capture parameters
-	SimpleCapParams capture;
-	capture.mWidth = WIDTH;
-	capture.mHeight = HEIGHT;
-	capture.mTargetBuf = new int[WIDTH * HEIGHT];
+	// Compressed recordings are written in the background, raw ones on the render thread
+	SessionRecorder recorder(WIDTH, HEIGHT);
+	if(recordPath && !recorder.Open(recordPath))
+		return -1;
 
-	// Game of life grid
-	int cellSize = 5;
-	int columns = WIDTH / cellSize;
-	int rows = HEIGHT / cellSize + 1;
-	std::vector<bool> grid(rows * columns, false);
+	RawSessionWriter rawRecorder;
+	if(recordRawPath && !rawRecorder.Open(recordRawPath, WIDTH, HEIGHT))
+		return -1;
+
+	// Create SFML window
+	const char* title = "Camera Trail (Stefan Ivanovski)";
+	sf::RenderWindow window(sf::VideoMode(WIDTH, HEIGHT), title);
 
-	// Game of life cell
-	sf::VertexArray gridVertices(sf::Quads);
-	sf::RectangleShape cell(sf::Vector2f((float)cellSize, (float)cellSize));
-	cell.setFillColor(sf::Color(255, 255, 255, 10));
+	// A fast replay runs uncapped and processes every recorded frame exactly once
+	bool fastReplay = replayPath && replayParams.pacing == ReplayPacing::FAST;
+	if(!fastReplay)
+		window.setFramerateLimit(60);
 
-	// Initialize capture for the first device (0)
-	if(initCapture(0, &capture) == 0)
+	// Camera image, trail and game of life grid
+	int cellSize = 5;
+	Canvas canvas(WIDTH, HEIGHT, cellSize);
+	canvas.SetFadeCurve(fadeCurve);
+	if(layered)
+		canvas.SetCompositing(Compositing::LAYERED);
+	canvas.SetCameraLayer(cameraLayer);
+	canvas.SetRegionOfInterest(roi, fullScanInterval);
+	canvas.SetMinLitPerCell(minLitPerCell);
+	canvas.SetLifeEngine(lifeEngine);
+	canvas.SetFastForward(fastForward);
+	canvas.SetBoundary(boundary);
+
+	// A vector kernel that disagrees with the scalar one is a bug, not worth the speed
+	if(!PixelKernelSelfTest())
+		canvas.SetKernelIsa(KernelIsa::SCALAR);
+	printf("Pixel kernel: %s\n", KernelIsaName(canvas.GetKernelIsa()));
+	if(!LifeKernelSelfTest())
+		canvas.SetLifeIsa(LifeIsa::SCALAR);
+	printf("Life kernel: %s\n", LifeIsaName(canvas.GetLifeIsa()));
+
+	// The frame is processed in row bands on every thread
+	WorkerPool workers(numThreads);
+	canvas.SetWorkerPool(&workers);
+	printf("Threads: %d\n", workers.NumThreads());
+
+	// Frames are captured on their own thread
+	CaptureRing capture(*source, fastReplay);
+	if(recordPath)
+		capture.SetSink(&recorder);
+	capture.Start();
+
+	// Wait for the first frame so there is always something to show
+	const Frame* frame = nullptr;
+	while(!(frame = capture.Latest()) && capture.Running())
+		sf::sleep(sf::milliseconds(1));
+
+	// The camera changes every frame, so it is streamed through pixel buffers
+	StreamingTexture camTexture;
+	if(!camTexture.Create(canvas.CameraWidth(), canvas.CameraHeight(), pixelBuffers))
 	{
-		printf("Capture failed - the device may be already in use.\n");
+		printf("Could not create the camera texture\n");
 		return -1;
 	}
+	camTexture.SetSmooth(cameraLayer == CameraLayer::DECIMATED);
+	printf("Upload: %s\n", camTexture.UsesPixelBuffers() ? "pixel buffers" : "direct");
+
+	// Only used when layered, the drawing on top of the camera
+	sf::Texture drawTexture;
+	if(layered)
+		drawTexture.create(WIDTH, HEIGHT);
 
-	sf::Image camImage;
-	camImage.create(WIDTH, HEIGHT);
-	sf::Texture camTexture;
+	// Built once, the textures they point at are updated in place
+	sf::Sprite camSprite(camTexture.Texture());
+	camSprite.setScale((float)WIDTH / canvas.CameraWidth(), (float)HEIGHT / canvas.CameraHeight());
+	sf::Sprite drawSprite(drawTexture);
 
 	// Precomputed rainbow colors (for performance)
 	std::vector<sf::Color> rainbowColors
@@ -159,9 +288,32 @@ int main()
 
 	DrawMode drawMode = DrawMode::NORMAL;
 	unsigned iteration = 0;
-	while(window.isOpen())
+	uint64_t lastRecorded = 0;
+	uint64_t recordedFrames = 0;
+
+	// Per-stage frame timings, shown with H
+	FrameProfiler profiler;
+	Hud hud(window, title);
+
+	// With --trace, T writes the last few seconds of the timeline to a file
+	TraceSetThreadName("render");
+	int traceFiles = 0;
+
+	// A fixed number of frames is for measuring, so the timings are always on
+	int frameCount = 0;
+	if(maxFrames)
+		profiler.SetEnabled(true);
+
+	// Smoothed, the full scans would otherwise make it jump
+	double thresholded = 1.0;
+
+	while(window.isOpen() && (!maxFrames || frameCount++ < maxFrames))
 	{
+		profiler.NextFrame();
+		TraceScope frameScope("frame");
+
 		sf::Event e;
+		ScopedTimer eventsTimer(profiler, FrameStage::EVENTS);
 		while(window.pollEvent(e))
 		{
 			if(e.type == sf::Event::Closed)
@@ -170,22 +322,7 @@ int main()
 			if(e.type == sf::Event::KeyPressed)
 			{
 				if(e.key.code == sf::Keyboard::Space)
-				{
-					if(!trail)
-					{
-						// Clear drawn image
-						for(int i = 0; i < HEIGHT; i++)
-						for(int j = 0; j < WIDTH; j++)
-						{
-							const sf::Color& c = camImage.getPixel(j, i);
-							camImage.setPixel(j, i, sf::Color(c.r, c.g, c.b, 255));
-						}
-					}
-
-					// Clear grid
-					for(size_t i = 0; i < grid.size(); i++)
-						grid.at(i) = false;
-				}
+					canvas.Clear(trail);
 
 				if(e.key.code == sf::Keyboard::LControl)
 					trail = !trail;
@@ -200,71 +337,159 @@ int main()
 					drawMode = DrawMode::GAME_OF_LIFE;
 				else if(e.key.code == sf::Keyboard::Num4)
 					drawMode = DrawMode::SAND;
+				else if(e.key.code == sf::Keyboard::Num5)
+					drawMode = DrawMode::STROKE;
+
+				// Packed, sparse, HashLife and round again. HashLife can jump many
+				// generations a frame, twice as many or half with every press.
+				if(e.key.code == sf::Keyboard::L)
+				{
+					LifeEngine engine = canvas.GetLifeEngine();
+					if(engine == LifeEngine::PACKED)
+						canvas.SetLifeEngine(LifeEngine::SPARSE);
+					else if(engine == LifeEngine::SPARSE)
+						canvas.SetLifeEngine(LifeEngine::HASHLIFE);
+					else
+						canvas.SetLifeEngine(LifeEngine::PACKED);
+				}
+				// Torus, dead border, mirror and round again
+				if(e.key.code == sf::Keyboard::B)
+				{
+					Boundary current = canvas.GetBoundary();
+					if(current == Boundary::TORUS)
+						canvas.SetBoundary(Boundary::DEAD);
+					else if(current == Boundary::DEAD)
+						canvas.SetBoundary(Boundary::MIRROR);
+					else
+						canvas.SetBoundary(Boundary::TORUS);
+				}
+				if(e.key.code == sf::Keyboard::Up)
+					canvas.SetFastForward(canvas.GetFastForward() + 1);
+				if(e.key.code == sf::Keyboard::Down)
+					canvas.SetFastForward(canvas.GetFastForward() - 1);
+
+				if(e.key.code == sf::Keyboard::H)
+					hud.Toggle(profiler);
+
+				if(e.key.code == sf::Keyboard::T && TraceEnabled())
+				{
+					char tracePath[64];
+					snprintf(tracePath, sizeof(tracePath), "camera-trail-%d.json", traceFiles++);
+					if(TraceWrite(tracePath, traceSeconds))
+						printf("Wrote the last %.0f seconds to %s\n", traceSeconds, tracePath);
+				}
 			}
 		}
+		eventsTimer.Stop();
 
-		// Capture a frame
-		doCapture(0);
-		
-		for(int i = 0; i < HEIGHT; i++)
-		for(int j = 0; j < WIDTH; j++)
+		// A replay that ran out still has its last frame to process
+		if(!capture.Running() && !capture.HasFresh())
 		{
-			const sf::Color& c = camImage.getPixel(j, i);
-			int r = (capture.mTargetBuf[i * WIDTH + j] >> 16) & 0xff;
-			int g = (capture.mTargetBuf[i * WIDTH + j] >> 8) & 0xff;
-			int b =  capture.mTargetBuf[i * WIDTH + j] & 0xff;
-			camImage.setPixel(j, i, sf::Color(r, g, b, c.a));
+			printf("Capture stopped.\n");
+			break;
+		}
 
-			if(drawMode != DrawMode::NONE && r >= TRESHOLD && g >= TRESHOLD && b >= TRESHOLD)
-			{
-				if(drawMode != DrawMode::SAND)	// Looks better without the trail
-					camImage.setPixel(j, i, sf::Color(r, g, b) - sf::Color(0, 0, 0, 200));
+		// Take the newest complete frame, without waiting for the camera
+		{
+			ScopedTimer timer(profiler, FrameStage::CAPTURE);
+			frame = capture.Latest();
+		}
 
-				grid.at((i / cellSize) * columns + j / cellSize) = true;
-			}
-			else if(trail && c.a != 255)
-				camImage.setPixel(j, i, sf::Color(r, g, b, c.a) + sf::Color(0, 0, 0, 3));
+		// Every frame is recorded once, even if it gets shown for several
+		if(recordRawPath && (recordedFrames == 0 || frame->sequence != lastRecorded))
+		{
+			rawRecorder.Write(*frame);
+			lastRecorded = frame->sequence;
+			recordedFrames++;
 		}
 
-		camTexture.loadFromImage(camImage);
-		sf::Sprite camSprite(camTexture);
+		{
+			ScopedTimer timer(profiler, FrameStage::PIXELS);
+			canvas.ProcessFrame(frame->pixels, frame->timestamp, drawMode, trail);
+		}
+		thresholded += (canvas.ThresholdedFraction() - thresholded) / 30.0;
+
+		{
+			ScopedTimer timer(profiler, FrameStage::UPLOAD);
+			if(canvas.CameraChanged())
+				camTexture.Update(canvas.Pixels());
+			if(layered)
+				canvas.UploadDrawing(drawTexture);
+		}
 
-		window.clear(sf::Color::White);
-		if(drawMode == DrawMode::RAINBOW)
-		{	
-			sf::Color& currentColor = rainbowColors.at(iteration++ % rainbowColors.size());
-			window.clear(currentColor);
-		} 
+		{
+			ScopedTimer timer(profiler, FrameStage::DRAW);
+			window.clear(sf::Color::White);
+			sf::Color background = sf::Color::White;
+			if(drawMode == DrawMode::RAINBOW)
+			{	
+				sf::Color& currentColor = rainbowColors.at(iteration++ % rainbowColors.size());
+				window.clear(currentColor);
+				background = currentColor;
+			} 
+
+			if(cameraLayer != CameraLayer::DISABLED)
+				window.draw(camSprite);
+			else
+				window.clear(sf::Color::Black);
 
-		window.draw(camSprite);
+			// The white drawing takes on the background color, just like the
+			// background shows through the camera when it is combined
+			if(layered)
+			{
+				drawSprite.setColor(background);
+				window.draw(drawSprite);
+			}
+		}
 
 		if(drawMode == DrawMode::GAME_OF_LIFE || drawMode == DrawMode::SAND)
 		{
-			gridVertices.clear();
-			for(int i = 0; i < rows; i++)
-			for(int j = 0; j < columns; j++)
 			{
-				if(grid.at(i * columns + j))
-				{
-					sf::Vector2f pos(j * (float)cellSize, i * (float)cellSize);
-					gridVertices.append(sf::Vertex(pos + cell.getPoint(0), sf::Color(255, 255, 255, 100)));
-					gridVertices.append(sf::Vertex(pos + cell.getPoint(1), sf::Color(255, 255, 255, 100)));
-					gridVertices.append(sf::Vertex(pos + cell.getPoint(2), sf::Color(255, 255, 255, 100)));
-					gridVertices.append(sf::Vertex(pos + cell.getPoint(3), sf::Color(255, 255, 255, 100)));
-				}
+				ScopedTimer timer(profiler, FrameStage::VERTICES);
+				canvas.BuildGridVertices();
 			}
 
-			window.draw(gridVertices);
+			{
+				ScopedTimer timer(profiler, FrameStage::DRAW);
+				window.draw(canvas.GridVertices());
+			}
 
-			if(drawMode == DrawMode::GAME_OF_LIFE || drawMode == DrawMode::SAND)
-				IterateCellularAutomata(grid, rows, columns, drawMode);
+			ScopedTimer timer(profiler, FrameStage::AUTOMATON);
+			canvas.StepAutomaton(drawMode);
 		}
+
+		if(hud.Visible())
+		{
+			char status[160];
+			int length = snprintf(status, sizeof(status), "thresholded %.1f%%", thresholded * 100.0);
+			if(drawMode == DrawMode::GAME_OF_LIFE && canvas.GetLifeEngine() == LifeEngine::HASHLIFE)
+			{
+				const HashLife& universe = canvas.Universe();
+				snprintf(status + length, sizeof(status) - length, ", generation %llu (2^%d a frame), %llu cells, %zu nodes",
+					(unsigned long long)universe.Generation(), canvas.GetFastForward(), (unsigned long long)universe.Population(), universe.NumNodes());
+			}
+			else if(drawMode == DrawMode::GAME_OF_LIFE && canvas.GetLifeEngine() == LifeEngine::SPARSE)
+				snprintf(status + length, sizeof(status) - length, ", %d of %d tiles active", canvas.ActiveLifeTiles(), canvas.NumLifeTiles());
+			hud.SetStatus(status);
+		}
+		hud.Draw(profiler);
+
+		ScopedTimer displayTimer(profiler, FrameStage::DISPLAY);
 		window.display();
 	}
 
-	while(isCaptureDone(0) == 0) {} // Wait for last capture to end
-	deinitCapture(0);
-	delete[] capture.mTargetBuf;
+	capture.Stop();
+	recorder.Close();
+	rawRecorder.Close();
+
+	if(maxFrames)
+	{
+		double frameTime = profiler.AverageFrameTime();
+		printf("Last %d frames: %.2f ms (%.0f fps)\n", profiler.Recorded(), frameTime, frameTime > 0.0 ? 1000.0 / frameTime : 0.0);
+		for(int s = 0; s < FrameProfiler::NUM_STAGES; s++)
+			printf("  %-10s %.3f ms\n", FrameStageName((FrameStage)s), profiler.AverageStageTime((FrameStage)s));
+		printf("  %-10s %.1f%% of pixels\n", "thresholded", thresholded * 100.0);
+	}
 
 	return 0;
 }
\ No newline at end of file